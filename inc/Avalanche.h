@@ -0,0 +1,140 @@
+/**
+ * @file Avalanche.h
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+#ifndef AVALANCHE_H_
+#define AVALANCHE_H_
+
+// General files
+#include <map>
+#include <vector>
+#include <iostream>
+#include <Histogram.h>
+
+/* **************************************************************************************
+ * Interface of Avalanche
+ * **************************************************************************************/
+
+/**
+ * Fit of a power law p(x) ~ x^-alpha by maximum likelihood, see [1]. For discrete data the
+ * estimator is approximately:
+ *   alpha = 1 + n [ sum_i ln (x_i / (x_min - 1/2)) ]^-1
+ * over the n samples with x_i >= x_min. Only n and the sum have to be kept, so the fit can be
+ * updated with every sample.
+ * [1] Power-law Distributions in Empirical Data (2009) Clauset et al.
+ */
+struct PowerLawFit {
+	PowerLawFit(long x_min = 1): x_min(x_min), n(0), sum(0) {}
+
+	//! Add a sample
+	void add(long x);
+
+	//! The exponent alpha, or 0 if there are no samples
+	double exponent() const;
+
+	//! The standard error of the exponent, (alpha - 1) / sqrt(n), or 0 if there is no exponent
+	double error() const;
+
+	long x_min;
+	long n;
+	double sum;
+};
+
+/**
+ * Streaming analysis of neuronal avalanches. It is fed with the number of spikes per tick. An
+ * avalanche is a sequence of (bins of) ticks with more spikes than the threshold per tick, bounded
+ * by quiet (bins of) ticks. Its size is the total number of spikes and its duration the number of
+ * bins. Sizes and durations are counted in histograms with logarithmic bins, and a power law is
+ * fitted to both while running. The memory used does not depend on the length of the run.
+ *
+ * It can be used as observer for Network::run, ticks without spikes are then derived from the
+ * gaps between the ticks it is called for.
+ */
+class Avalanche {
+public:
+	//! Bins with at most threshold spikes per tick (threshold * bin in total) are quiet, a bin
+	//! spans the given number of ticks
+	Avalanche(int threshold = 0, int bin = 1, int bins_per_decade = 10);
+
+	//! Add the number of spikes in the next tick
+	void add(int spikes);
+
+	//! Add a number of ticks without any spike
+	void addSilence(long ticks);
+
+	//! Observer for Network::run
+	void operator()(int t, const std::vector<int> & fired);
+
+	//! End an ongoing avalanche (e.g. at the end of a run)
+	void flush();
+
+	//! Number of avalanches
+	inline long count() const { return avalanches; }
+
+	//! The power law fit to the avalanche sizes
+	inline const PowerLawFit & sizeFit() const { return size_fit; }
+
+	//! The power law fit to the avalanche durations
+	inline const PowerLawFit & durationFit() const { return duration_fit; }
+
+	//! Set the smallest size and duration that are taken along in the fits (resets them)
+	void setMinimum(long size_min, long duration_min);
+
+	//! Histogram of the avalanche sizes
+	inline const Histogram & getSizes() const { return size_histogram; }
+
+	//! Histogram of the avalanche durations
+	inline const Histogram & getDurations() const { return duration_histogram; }
+
+	//! Print the fits
+	void print(std::ostream & out) const;
+
+private:
+	//! Finish the current bin
+	void endBin();
+
+	int threshold;
+
+	int bin;
+
+	//! Ticks and spikes in the current bin
+	int bin_ticks;
+	long bin_spikes;
+
+	//! Size and duration of the current avalanche
+	long size;
+	long duration;
+
+	//! Last tick seen as observer
+	int last_tick;
+
+	long avalanches;
+
+	Histogram size_histogram;
+	Histogram duration_histogram;
+
+	PowerLawFit size_fit;
+	PowerLawFit duration_fit;
+};
+
+#endif /* AVALANCHE_H_ */
@@ -27,6 +27,11 @@
 
 // General files
 #include <map>
+#include <vector>
+#include <iostream>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
 #include <math.h>
 
 /* **************************************************************************************
@@ -39,8 +44,8 @@
 typedef double DC_TYPE;
 
 /**
- * Internally the data is stored as DataItem%s and this is also how data is communicated to the plotting
- * functions.
+ * Data is communicated to the plotting functions as DataItem%s. Internally the fields are stored in
+ * separate arrays, see DataLayout.
  */
 struct DataItem {
 	int coord_x;
@@ -48,7 +53,35 @@ struct DataItem {
 	DC_TYPE value;
 };
 
-typedef std::vector<DataItem*> DC_DATA_ITEMS;
+/**
+ * How the items are stored. In DL_COLUMNS every field of the items has its own contiguous array.
+ * In DL_BITS the container is a boolean raster: columns of "height" bits, packed 64 in a word,
+ * with only the x-coordinate stored per column. A 1000 neuron x 5000 tick spike raster then
+ * takes 625 kB.
+ */
+enum DataLayout { DL_COLUMNS, DL_BITS };
+
+/**
+ * Header of the binary file format of a DataContainer, see DataContainer::write. It is followed
+ * by the raw arrays of the layout, in logical order (a window that wrapped around is stored
+ * unwrapped):
+ *   DL_COLUMNS: values DC_TYPE[count], coord_x int32[count], coord_y int32[count]
+ *   DL_BITS:    bits uint64[(count+63)/64], column_x int32[columns]
+ * The header is a multiple of 8 bytes, so the first array is aligned when the file is mapped.
+ */
+struct DataFileHeader {
+	char magic[4];				// "DCNT"
+	uint32_t byte_order;		// DataFileByteOrder as written by the machine that stored it
+	uint32_t version;
+	int32_t layout;
+	int32_t id;
+	int32_t height;
+	uint64_t count;
+	uint64_t columns;
+};
+
+const uint32_t DataFileByteOrder = 0x01020304;
+const uint32_t DataFileVersion = 1;
 
 /**
  * The idea of DataContainer was that it did not actually contain the data itself, but only references to the
@@ -100,8 +133,25 @@ public:
 //		dataType = DT_F2DARRAY;
 //	}
 
+	//! Set the layout, which can only be done while the container is empty
+	void setLayout(DataLayout layout);
+
+	//! Reserve memory for the given number of items (in the current layout)
+	void reserve(size_t items);
+
+	/**
+	 * Keep only the last "columns" columns, so the memory stays the same however long a run is.
+	 * With decimation > 0 the columns that drop out are averaged per "decimation" columns into
+	 * the history container, which keeps the last history_columns of those. The window can only
+	 * be set while the container is empty and only columns of the same height can be added.
+	 */
+	void setWindow(int columns, int decimation = 0, int history_columns = 0);
+
+	//! The decimated history of a window (NULL if there is none)
+	inline DataContainer *getHistory() { return history; }
+
 	//! Add a data item
-	void addItem(DataItem *item);
+	void addItem(const DataItem & item);
 
 	//! Add a series of items
 	void addItems(std::map<DC_TYPE,int> & items);
@@ -109,23 +159,63 @@ public:
 	//! Add a series of items
 	void addItems(std::vector<DC_TYPE> & items, int xcoord);
 
+	//! Add a column of count items with y-coordinates 0..count-1 at once
+	void addItems(const DC_TYPE *items, size_t count, int xcoord);
+
+	//! Add a column of a boolean raster (stored bit-packed, so use it for all columns)
+	void addItems(const std::vector<bool> & items, int xcoord);
+
 	//! Remove all items
 	void clear();
 
 	//! Get a data item
-	DataItem * getItem(int index);
+	DataItem getItem(size_t index) const;
+
+	//! Get only the value of a data item
+	inline DC_TYPE value(size_t index) const {
+		index = physical(index);
+		if (layout == DL_BITS) return (bit_data[index >> 6] >> (index & 63)) & 1;
+		return value_data[index];
+	}
 
 	//! Return number of data elements
-	int size();
+	inline size_t size() const { return count; }
+
+	//! How the data is stored
+	inline DataLayout getLayout() const { return layout; }
+
+	//! In a window the oldest column is not the first one in the arrays below, but this one
+	inline int getFirstColumn() const { return first_column; }
+
+	//! The x-coordinates (DL_COLUMNS only)
+	inline const int *coordX() const { return x_data; }
+
+	//! The y-coordinates (DL_COLUMNS only)
+	inline const int *coordY() const { return y_data; }
+
+	//! The values (DL_COLUMNS only)
+	inline const DC_TYPE *getValues() const { return value_data; }
 
 	//! Return width
-	inline int height() { return data_height; }
+	inline int height() const { return data_height; }
+
+	//! Read data in the binary format from a stream (can be a file), returns false on failure
+	bool read(std::istream& in);
+
+	//! Write data in the binary format to a stream
+	bool write(std::ostream& out) const;
 
-	//! Read data from stream (can be a file)
-	void read(std::istream& in);
+	//! Write data in the binary format to a file, with a single write call
+	bool write(const std::string & file) const;
 
-	//! Write to file or stream
-	void write(std::ostream& out);
+	/**
+	 * Map a file in the binary format read-only into memory. Nothing is copied, the pages are
+	 * read when the items are accessed. The container can not be changed until it is cleared.
+	 */
+	bool map(const std::string & file);
+
+	//! If the data lives in a mapped file
+	inline bool mapped() const { return mapping != NULL; }
 
 	//! Calculate the slope in the loglog plot
 	float CalculateSlope();
@@ -139,14 +229,87 @@ public:
 	//! Apply bins to the data (in DT_MAP case)
 //	void ApplyBins(int no_bins, DataDecoratorType min, DataDecoratorType max);
 private:
+	//! Containers are not copied, they own their history
+	DataContainer(const DataContainer &);
+	DataContainer & operator=(const DataContainer &);
+
+	//! Index in the arrays of the given item, these differ when the window has wrapped around
+	inline size_t physical(size_t index) const {
+		if (!first_column) return index;
+		size_t column = index / data_height + first_column;
+		if (column >= (size_t)window) column -= window;
+		return column * data_height + index % data_height;
+	}
+
+	//! Make room for a column and return the index in the arrays at which it starts
+	size_t appendColumn(int height, int xcoord);
+
+	//! Average a column that drops out of the window into the history
+	void decimate(int column);
+
+	//! Point the data pointers to the arrays, after these have been changed
+	void sync();
+
+	//! Fill the header for the binary format
+	void header(DataFileHeader & header) const;
+
+	//! The arrays in logical order (as parts of at most size bytes), for the binary format
+	void segments(std::vector< std::pair<const void*,size_t> > & parts, std::vector<uint64_t> & scratch) const;
+
+	//! Release a mapped file
+	void unmap();
+
 	//! The identifier for this container
 	int id;
 
-	//! Internal structure of data
-	DC_DATA_ITEMS data_items;
+	//! How the data is stored
+	DataLayout layout;
+
+	//! Number of items
+	size_t count;
+
+	//! DL_COLUMNS: one array per field
+	std::vector<int> coord_x;
+	std::vector<int> coord_y;
+	std::vector<DC_TYPE> values;
+
+	//! DL_BITS: the bits, and the x-coordinate of every column
+	std::vector<uint64_t> bits;
+	std::vector<int> column_x;
 
 	//! Height of the to-be-created 2D map
 	int data_height;
+
+	//! Number of columns that have been added (up to window)
+	int columns;
+
+	//! Maximum number of columns, 0 if there is no maximum
+	int window;
+
+	//! The column in the arrays that is the oldest one
+	int first_column;
+
+	//! The number of columns that are averaged into one column of the history
+	int decimation;
+
+	//! Sum of the columns to be averaged, how many there are and the x-coordinate of the first
+	std::vector<DC_TYPE> decimated;
+	int decimated_columns;
+	int decimated_x;
+
+	//! Decimated history of the window
+	DataContainer *history;
+
+	//! The data, in the arrays above or in a mapped file
+	const int *x_data;
+	const int *y_data;
+	const DC_TYPE *value_data;
+	const uint64_t *bit_data;
+	const int *column_x_data;
+
+	//! A file mapped by map(), and its size
+	void *mapping;
+	size_t mapping_size;
 };
 
 #endif /* DATADECORATOR_H_ */
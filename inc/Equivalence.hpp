@@ -0,0 +1,217 @@
+/**
+ * @file Equivalence.hpp
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+#ifndef EQUIVALENCE_H_
+#define EQUIVALENCE_H_
+
+// General files
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+
+#include <Network.h>
+
+/* **************************************************************************************
+ * Interface of Equivalence
+ * **************************************************************************************/
+
+/**
+ * The outcome of a comparison between a reference and a candidate engine. The comparison is
+ * exact if every spike and every weight is identical. If not, it can still be statistically
+ * equivalent when the firing rates and the weight distributions are within tolerance.
+ */
+struct EquivalenceReport {
+	//! Number of ticks compared
+	int ticks;
+
+	//! First tick at which the spike rasters differ, -1 if they never do
+	int first_tick;
+
+	//! First neuron that differs at first_tick
+	int first_neuron;
+
+	//! Total number of (tick, neuron) pairs in which the rasters differ
+	long spike_mismatches;
+
+	//! First tick at which the weights differ, -1 if they never do
+	int first_weight_tick;
+
+	//! Mean firing rate (spikes per neuron per tick) of reference and candidate
+	double reference_rate, candidate_rate;
+
+	//! Mean over neurons of the absolute difference in firing rate
+	double neuron_rate_diff;
+
+	//! Largest Kolmogorov-Smirnov statistic between the weight distributions
+	double weight_ks;
+
+	//! Rasters and weights are identical
+	bool exact;
+
+	//! Rates and weight distributions are within tolerance
+	bool statistical;
+
+	void print(std::ostream & out) const {
+		out << "Compared " << ticks << " ticks: " << (exact ? "exact" :
+				(statistical ? "statistically equivalent" : "NOT equivalent")) << std::endl;
+		if (first_tick >= 0) {
+			out << "  first divergent spike at tick " << first_tick << " neuron " << first_neuron
+					<< " (" << spike_mismatches << " mismatches in total)" << std::endl;
+		}
+		if (first_weight_tick >= 0) {
+			out << "  first divergent weight at tick " << first_weight_tick << std::endl;
+		}
+		out << "  rate " << reference_rate << " vs " << candidate_rate << ", per neuron difference "
+				<< neuron_rate_diff << ", weight KS statistic " << weight_ks << std::endl;
+	}
+};
+
+/**
+ * A harness that runs a reference Network and a candidate engine side by side and compares
+ * them tick by tick. Both should have been constructed in the same way from the same seed, so
+ * an engine that does exactly the same should produce exactly the same rasters.
+ *
+ * The candidate can be anything with the same interface as Network for:
+ * - void tick()
+ * - int getSpikes(std::vector<bool> &)
+ * - void getWeights(std::vector<NN_VALUE> &)
+ *
+ * The rate tolerance is relative to the rate of the reference. The weight tolerance is the
+ * maximum allowed Kolmogorov-Smirnov statistic between the weight distributions.
+ */
+template <typename Candidate = Network>
+class Equivalence {
+public:
+	Equivalence(Network & reference, Candidate & candidate):
+		reference(reference), candidate(candidate), rate_tolerance(0.1), weight_tolerance(0.1) {}
+
+	//! Tolerances used for the statistical comparison
+	inline void setTolerance(double rate, double weight) {
+		rate_tolerance = rate;
+		weight_tolerance = weight;
+	}
+
+	//! Run both engines for a number of ticks, compare weights every weight_interval ticks
+	EquivalenceReport run(int ticks, int weight_interval = 100) {
+		EquivalenceReport report;
+		report.ticks = ticks;
+		report.first_tick = report.first_neuron = report.first_weight_tick = -1;
+		report.spike_mismatches = 0;
+		report.reference_rate = report.candidate_rate = report.neuron_rate_diff = 0;
+		report.weight_ks = 0;
+
+		std::vector<long> ref_count, cand_count;
+		long ref_total = 0, cand_total = 0;
+		int size = 0;
+
+		for (int t = 0; t < ticks; ++t) {
+			reference.tick();
+			candidate.tick();
+			ref_total += reference.getSpikes(ref_spikes);
+			cand_total += candidate.getSpikes(cand_spikes);
+			if (t == 0) {
+				size = ref_spikes.size();
+				ref_count.resize(size, 0);
+				cand_count.resize(size, 0);
+			}
+			if (ref_spikes.size() != cand_spikes.size()) {
+				std::cerr << "Engines differ in size: " << ref_spikes.size() << " vs "
+						<< cand_spikes.size() << std::endl;
+				report.exact = report.statistical = false;
+				report.ticks = t;
+				return report;
+			}
+			for (int i = 0; i < size; ++i) {
+				if (ref_spikes[i]) ref_count[i]++;
+				if (cand_spikes[i]) cand_count[i]++;
+				if (ref_spikes[i] != cand_spikes[i]) {
+					if (report.first_tick < 0) {
+						report.first_tick = t;
+						report.first_neuron = i;
+					}
+					report.spike_mismatches++;
+				}
+			}
+			if ((weight_interval > 0 && !((t + 1) % weight_interval)) || t == ticks - 1) {
+				compareWeights(report, t);
+			}
+		}
+
+		report.reference_rate = size ? ref_total / ((double)size * ticks) : 0;
+		report.candidate_rate = size ? cand_total / ((double)size * ticks) : 0;
+		double diff = 0;
+		for (int i = 0; i < size; ++i) {
+			diff += fabs((double)(ref_count[i] - cand_count[i]));
+		}
+		report.neuron_rate_diff = size ? diff / ((double)size * ticks) : 0;
+
+		report.exact = (report.first_tick < 0 && report.first_weight_tick < 0);
+		double rate_diff = fabs(report.reference_rate - report.candidate_rate);
+		report.statistical = report.exact || (rate_diff <= rate_tolerance * report.reference_rate
+				&& report.weight_ks <= weight_tolerance);
+		return report;
+	}
+
+protected:
+	/**
+	 * Weights are compared exactly, and by the Kolmogorov-Smirnov statistic: the largest distance
+	 * between the empirical cumulative distributions of both sets of weights.
+	 */
+	void compareWeights(EquivalenceReport & report, int t) {
+		reference.getWeights(ref_weights);
+		candidate.getWeights(cand_weights);
+		if (report.first_weight_tick < 0 && ref_weights != cand_weights) {
+			report.first_weight_tick = t;
+		}
+		if (ref_weights.empty() || cand_weights.empty()) return;
+		std::sort(ref_weights.begin(), ref_weights.end());
+		std::sort(cand_weights.begin(), cand_weights.end());
+		size_t i = 0, j = 0;
+		double ks = 0;
+		while (i < ref_weights.size() && j < cand_weights.size()) {
+			NN_VALUE w = std::min(ref_weights[i], cand_weights[j]);
+			while (i < ref_weights.size() && ref_weights[i] <= w) ++i;
+			while (j < cand_weights.size() && cand_weights[j] <= w) ++j;
+			double d = fabs((double)i / ref_weights.size() - (double)j / cand_weights.size());
+			if (d > ks) ks = d;
+		}
+		if (ks > report.weight_ks) report.weight_ks = ks;
+	}
+
+private:
+	Network & reference;
+
+	Candidate & candidate;
+
+	double rate_tolerance;
+
+	double weight_tolerance;
+
+	//! Buffers, so they are not allocated every tick
+	std::vector<bool> ref_spikes, cand_spikes;
+	std::vector<NN_VALUE> ref_weights, cand_weights;
+};
+
+#endif /* EQUIVALENCE_H_ */
@@ -27,71 +27,214 @@
 
 // General files
 #include <map>
+#include <vector>
 #include <iostream>
 #include <iomanip>
 #include <iterator>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <Histogram.h>
 
 /* **************************************************************************************
  * Interface of EventCounter
  * **************************************************************************************/
 
+/**
+ * Properties of the "type" of an event. Integral types can be counted in a dense array, all
+ * other types are hashed. The generic hash works on the bytes of the type, so for anything
+ * else than plain old data a specialization of EventKey should be written.
+ */
+template <typename T>
+struct EventKey {
+	static const bool integral = false;
+	static inline long index(const T &) { return 0; }
+	static inline T key(long) { return T(); }
+	static inline size_t hash(const T & key) {
+		// FNV-1a over the bytes of the key
+		const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&key);
+		uint64_t h = 14695981039346656037ULL;
+		for (size_t i = 0; i < sizeof(T); ++i) {
+			h = (h ^ bytes[i]) * 1099511628211ULL;
+		}
+		return (size_t)h;
+	}
+};
+
+//! Multiplicative hash, the high bits are mixed into the low bits that are used by the table
+inline size_t EventHashMix(uint64_t x) {
+	x *= 0x9E3779B97F4A7C15ULL;
+	return (size_t)(x ^ (x >> 32));
+}
+
+#define EVENT_KEY_INTEGRAL(TYPE) \
+template <> \
+struct EventKey<TYPE> { \
+	static const bool integral = true; \
+	static inline long index(const TYPE & key) { return (long)key; } \
+	static inline TYPE key(long index) { return (TYPE)index; } \
+	static inline size_t hash(const TYPE & key) { return EventHashMix((uint64_t)key); } \
+};
+
+EVENT_KEY_INTEGRAL(char)
+EVENT_KEY_INTEGRAL(signed char)
+EVENT_KEY_INTEGRAL(unsigned char)
+EVENT_KEY_INTEGRAL(short)
+EVENT_KEY_INTEGRAL(unsigned short)
+EVENT_KEY_INTEGRAL(int)
+EVENT_KEY_INTEGRAL(unsigned int)
+EVENT_KEY_INTEGRAL(long)
+EVENT_KEY_INTEGRAL(unsigned long)
+EVENT_KEY_INTEGRAL(long long)
+EVENT_KEY_INTEGRAL(unsigned long long)
+
+#undef EVENT_KEY_INTEGRAL
+
+//! Floating point keys are hashed on their bits, with -0.0 and 0.0 being the same key
+#define EVENT_KEY_FLOATING(TYPE) \
+template <> \
+struct EventKey<TYPE> { \
+	static const bool integral = false; \
+	static inline long index(const TYPE &) { return 0; } \
+	static inline TYPE key(long) { return TYPE(); } \
+	static inline size_t hash(const TYPE & key) { \
+		TYPE k = (key == 0) ? 0 : key; uint64_t bits = 0; \
+		memcpy(&bits, &k, sizeof(TYPE)); \
+		return EventHashMix(bits); \
+	} \
+};
+
+EVENT_KEY_FLOATING(float)
+EVENT_KEY_FLOATING(double)
+
+#undef EVENT_KEY_FLOATING
+
 /**
  * Count events of a given "type" (might e.g. be size)
+ *
+ * There are two backends. Integral types are counted in a dense array that covers the range of
+ * types seen so far, as long as that range stays below MaxDenseRange. Other types, or integral
+ * types with a range that is too large, are counted in an open-addressing hash table with linear
+ * probing. In both cases AddEvent does not allocate, except when the storage has to grow.
+ *
+ * Instances can be used per thread and added together afterwards with merge().
  */
 template <typename T>
 class EventCounter {
 public:
+	//! Largest range of integral types that is counted in a dense array
+	static const long MaxDenseRange = 1 << 20;
+
 	//! Construct an event counter
-	EventCounter() { events.clear(); }
+	EventCounter() { clear(); }
 
 	//! Add one event of given type
-	void AddEvent(const T type) {
-		typename std::map<T,int>::iterator f = events.find(type);
-		if (f == events.end()) {
-			events.insert(std::make_pair<T,int>(type, 1));
-		} else {
-			(*f).second++;
-		}
+	inline void AddEvent(const T type) {
+		AddEvent(type, 1);
 	}
 
 	//! Add "freq" events of a given type
-	void AddEvent(const T type, int freq) {
-		typename std::map<T,int>::iterator f = events.find(type);
-		if (f == events.end()) {
-			events.insert(std::make_pair<T,int>(type, freq));
+	inline void AddEvent(const T type, int freq) {
+		if (dense) {
+			unsigned long i = EventKey<T>::index(type) - offset;
+			if (i < dense_counts.size()) {
+				if (!dense_counts[i]) ++distinct;
+				dense_counts[i] += freq;
+				if (!dense_counts[i]) --distinct;
+				return;
+			}
+			if (GrowDense(type)) {
+				AddEvent(type, freq);
+				return;
+			}
+		}
+		int *counter = Find(type);
+		if (!*counter) ++distinct;
+		*counter += freq;
+		if (!*counter) --distinct;
+	}
+
+	//! Add the events of another counter (e.g. one per thread) to this one
+	void merge(const EventCounter<T> & other) {
+		if (other.dense) {
+			for (size_t i = 0; i < other.dense_counts.size(); ++i) {
+				if (other.dense_counts[i])
+					AddEvent(EventKey<T>::key(other.offset + i), other.dense_counts[i]);
+			}
 		} else {
-			(*f).second += freq;
+			for (size_t i = 0; i < other.hash_used.size(); ++i) {
+				if (other.hash_used[i])
+					AddEvent(other.hash_keys[i], other.hash_counts[i]);
+			}
+		}
+	}
+
+	//! Number of events of the given type
+	int count(const T type) const {
+		if (dense) {
+			unsigned long i = EventKey<T>::index(type) - offset;
+			return (i < dense_counts.size()) ? dense_counts[i] : 0;
+		}
+		if (hash_used.empty()) return 0;
+		size_t mask = hash_used.size() - 1;
+		for (size_t i = EventKey<T>::hash(type) & mask; hash_used[i]; i = (i + 1) & mask) {
+			if (hash_keys[i] == type) return hash_counts[i];
 		}
+		return 0;
 	}
 
-	//! Take the existing events and put them in bins
+	//! Number of different types of events (with a count that is not zero)
+	inline size_t size() const { return distinct; }
+
+	//! Remove all events
+	void clear() {
+		dense = EventKey<T>::integral;
+		offset = 0;
+		distinct = 0;
+		hash_slots = 0;
+		dense_counts.clear();
+		hash_keys.clear();
+		hash_counts.clear();
+		hash_used.clear();
+		events.clear();
+	}
+
+	/**
+	 * Take the existing events and put them in bins. This rebuilds the counter, so for binning
+	 * while counting, or on a logarithmic scale, add the events to a Histogram instead.
+	 */
 	void Bin(int no_bins, T min, T max) {
 		typename std::map<T,int>::iterator f;
-		if (events.empty()) return;
+		if (!size()) return;
 		EventCounter binned_cntr;
 
 		T delta = (max - min) / no_bins;
-		std::cout << "Delta is " << delta << std::endl;
-		for (f = events.begin(); f != events.end(); ++f) {
+		std::map<T,int> & sorted = getEvents();
+		for (f = sorted.begin(); f != sorted.end(); ++f) {
 			T value = (*f).first;
 			int bin_id = 0;
 			if (value >= min) bin_id = (value - min) / delta;
 			if (value > max) bin_id = no_bins;
 			T bin_value = min + delta * bin_id;
-//			std::cout << "Bin id is " << bin_id << "(" << value << "-" << min << ") /" << no_bins << " and bin value thus: " << bin_value << std::endl;
 			binned_cntr.AddEvent(bin_value, (*f).second);
 		}
-		int size = events.size();
-		events.clear();
-		for (f = binned_cntr.getEvents().begin(); f != binned_cntr.getEvents().end(); ++f) {
-			AddEvent(f->first, f->second);
-		}
-		std::cerr << "Goes from size " << size << " to " << events.size() << std::endl;
-		if (events.size() < 10) {
-			std::cerr << "Maybe use more than " << no_bins << " bins" << std::endl;
-		}
+		clear();
+		merge(binned_cntr);
+	}
 
-		// add e.g. assert on nr of events (should be the same)
+	//! Add the events to a histogram (which does not need to be empty)
+	void Fill(Histogram & histogram) const {
+		if (dense) {
+			for (size_t i = 0; i < dense_counts.size(); ++i) {
+				if (dense_counts[i])
+					histogram.add(EventKey<T>::key(offset + i), dense_counts[i]);
+			}
+		} else {
+			for (size_t i = 0; i < hash_used.size(); ++i) {
+				if (hash_used[i] && hash_counts[i])
+					histogram.add(hash_keys[i], hash_counts[i]);
+			}
+		}
 	}
 
 	//! Print
@@ -99,17 +242,18 @@ public:
 		typename std::map<T,int>::iterator f;
 
 		int line_items = 20; int i = 0;
+		std::map<T,int> & sorted = getEvents();
 
 		switch (print_list) {
 		case 0:
-			for (f = events.begin(); f != events.end(); ++f) {
+			for (f = sorted.begin(); f != sorted.end(); ++f) {
 				std::cout << (*f).first << ":" << (*f).second << " ";
 				if (++i == line_items) { std::cout << std::endl; i = 0; }
 			}
 			break;
 		case 1:
 			++i;
-			for (f = events.begin(); f != events.end(); ++f, ++i) {
+			for (f = sorted.begin(); f != sorted.end(); ++f, ++i) {
 				int index = (*f).first;
 				for (int j = 0; j < index - i; ++i) {
 					std::cout << std::setw(2) << 0 << " ";
@@ -126,10 +270,120 @@ public:
 
 	}
 
-	//! Get events
-	std::map<T, int> & getEvents() { return events; }
+	/**
+	 * Get the events sorted by type. This is a snapshot that is built on every call, so it should
+	 * not be used while counting.
+	 */
+	std::map<T, int> & getEvents() {
+		events.clear();
+		if (dense) {
+			for (size_t i = 0; i < dense_counts.size(); ++i) {
+				if (dense_counts[i])
+					events.insert(std::make_pair(EventKey<T>::key(offset + i), dense_counts[i]));
+			}
+		} else {
+			for (size_t i = 0; i < hash_used.size(); ++i) {
+				if (hash_used[i] && hash_counts[i])
+					events.insert(std::make_pair(hash_keys[i], hash_counts[i]));
+			}
+		}
+		return events;
+	}
 private:
-	//! Probably a sparse vector is the best, but to stay in STL, we will use a map
+	/**
+	 * Extend the dense array so it covers the given type, to the next power of two of the range,
+	 * so growing happens only a few times. If the range becomes too large, the counts are moved
+	 * to the hash table and false is returned.
+	 */
+	bool GrowDense(const T type) {
+		long index = EventKey<T>::index(type);
+		if (dense_counts.empty()) {
+			offset = index;
+			dense_counts.resize(64, 0);
+			return true;
+		}
+		long lo = std::min(offset, index);
+		long hi = std::max(offset + (long)dense_counts.size(), index + 1);
+		if (hi - lo > MaxDenseRange) {
+			std::vector<int> counts;
+			counts.swap(dense_counts);
+			dense = false;
+			distinct = 0;
+			for (size_t i = 0; i < counts.size(); ++i) {
+				if (counts[i]) AddEvent(EventKey<T>::key(offset + i), counts[i]);
+			}
+			return false;
+		}
+		long range = dense_counts.size();
+		while (range < hi - lo) range <<= 1;
+		// keep some room at the side at which the array has been extended
+		if (index < offset) lo = hi - range;
+		std::vector<int> counts(range, 0);
+		std::copy(dense_counts.begin(), dense_counts.end(), counts.begin() + (offset - lo));
+		dense_counts.swap(counts);
+		offset = lo;
+		return true;
+	}
+
+	//! Find or insert the counter of the given type in the hash table
+	int *Find(const T type) {
+		if ((hash_slots + 1) * 2 > hash_used.size()) GrowHash();
+		size_t mask = hash_used.size() - 1;
+		size_t i = EventKey<T>::hash(type) & mask;
+		for (; hash_used[i]; i = (i + 1) & mask) {
+			if (hash_keys[i] == type) return &hash_counts[i];
+		}
+		hash_used[i] = 1;
+		hash_keys[i] = type;
+		hash_counts[i] = 0;
+		++hash_slots;
+		return &hash_counts[i];
+	}
+
+	//! Double the hash table (load factor stays below 1/2)
+	void GrowHash() {
+		std::vector<T> keys;
+		std::vector<int> counts;
+		std::vector<unsigned char> used;
+		keys.swap(hash_keys);
+		counts.swap(hash_counts);
+		used.swap(hash_used);
+		size_t capacity = used.empty() ? 64 : used.size() * 2;
+		hash_keys.resize(capacity);
+		hash_counts.resize(capacity, 0);
+		hash_used.resize(capacity, 0);
+		size_t mask = capacity - 1;
+		for (size_t j = 0; j < used.size(); ++j) {
+			if (!used[j]) continue;
+			size_t i = EventKey<T>::hash(keys[j]) & mask;
+			while (hash_used[i]) i = (i + 1) & mask;
+			hash_used[i] = 1;
+			hash_keys[i] = keys[j];
+			hash_counts[i] = counts[j];
+		}
+	}
+
+	//! Events are counted in the dense array
+	bool dense;
+
+	//! The type corresponding to the first element of the dense array
+	long offset;
+
+	//! Number of different types with a count that is not zero
+	size_t distinct;
+
+	//! Number of used slots of the hash table, including those of types counted back to zero
+	size_t hash_slots;
+
+	//! Dense backend, counts for the types offset, offset+1, ...
+	std::vector<int> dense_counts;
+
+	//! Hash backend, types, their counts and whether a slot is used
+	std::vector<T> hash_keys;
+	std::vector<int> hash_counts;
+	std::vector<unsigned char> hash_used;
+
+	//! Sorted snapshot returned by getEvents()
 	std::map<T, int> events;
 };
 
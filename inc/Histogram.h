@@ -0,0 +1,127 @@
+/**
+ * @file Histogram.h
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+// General files
+#include <map>
+#include <vector>
+
+/* **************************************************************************************
+ * Interface of Histogram
+ * **************************************************************************************/
+
+//! How the range of a histogram is divided into bins
+enum HistogramScale {
+	HS_LINEAR,						// bins of equal width
+	HS_LOG,							// bins of equal width on a logarithmic scale
+	HS_HDR,							// per power of two a fixed number of linear bins
+	HS_COUNT
+};
+
+/**
+ * A histogram with a fixed number of bins over [min, max). Values below and above the range are
+ * counted separately. Adding a value takes constant time and the samples themselves are never
+ * stored, so it can be used in the inner loop of a simulation and for data that spans many
+ * orders of magnitude.
+ *
+ * With HS_HDR the range is divided in powers of two, and each of them in "bins" linear bins (a
+ * power of two), so the relative error is at most 1/bins over the whole range. This is the
+ * layout of HdrHistogram. For HS_LOG and HS_HDR the minimum should be positive.
+ */
+class Histogram {
+public:
+	//! Histogram with the given number of bins, for HS_HDR the number of bins per power of two
+	Histogram(HistogramScale scale, double min, double max, int bins);
+
+	//! Add a value (count times), NaN is counted below the minimum
+	inline void add(double value, long count = 1) {
+		total += count;
+		if (!(value >= min)) { underflow += count; return; }
+		if (value >= max) { overflow += count; return; }
+		int i = index(value);
+		if (i >= (int)counts.size()) i = counts.size() - 1;
+		counts[i] += count;
+	}
+
+	//! Add the counts of a histogram with the same layout
+	void merge(const Histogram & other);
+
+	//! Remove all values
+	void clear();
+
+	//! The value below which the given fraction (0..1) of the values lies, estimated per bin
+	double quantile(double q) const;
+
+	//! Number of values
+	inline long count() const { return total; }
+
+	//! Number of values below the minimum
+	inline long below() const { return underflow; }
+
+	//! Number of values above the maximum
+	inline long above() const { return overflow; }
+
+	//! Number of bins
+	inline int bins() const { return counts.size(); }
+
+	//! Count in bin i
+	inline long at(int i) const { return counts[i]; }
+
+	//! Lower bound of bin i, within [min, max]
+	double lower(int i) const;
+
+	//! Upper bound of bin i
+	inline double upper(int i) const { return (i + 1 < (int)counts.size()) ? lower(i + 1) : max; }
+
+	//! Non-empty bins, with the lower bound as key
+	void getBins(std::map<double,long> & result) const;
+
+private:
+	//! Bin of a value in [min, max)
+	int index(double value) const;
+
+	HistogramScale scale;
+
+	double min;
+
+	double max;
+
+	//! Width of a bin (HS_LINEAR), log of the ratio between bins (HS_LOG), bins per octave (HS_HDR)
+	double step;
+
+	//! The power of two of the minimum (HS_HDR)
+	int min_exponent;
+
+	std::vector<long> counts;
+
+	long total;
+
+	long underflow;
+
+	long overflow;
+};
+
+#endif /* HISTOGRAM_H_ */
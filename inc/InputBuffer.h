@@ -0,0 +1,98 @@
+/***************************************************************************************************
+ * @brief
+ * @file InputBuffer.h
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+#ifndef INPUTBUFFER_H_
+#define INPUTBUFFER_H_
+
+#include <vector>
+#include <deque>
+#include <stddef.h>
+#include <Neuron.h>
+
+/**
+ * External input for a network, scheduled ahead of time. There are two kinds of input:
+ * - spike events (tick, neuron), the neuron is made to fire at that tick;
+ * - current frames, one current per input neuron per tick, that drive the NL_INPUT neurons.
+ *
+ * Spike events are kept in a ring buffer with one slot per tick. The ring grows when events are
+ * scheduled further ahead than it reaches, so a sensory stream can be added in large chunks.
+ * Current frames are not copied. The caller hands over a block of frames and keeps the memory
+ * alive until the network has passed the last tick of the block, see pendingBlocks().
+ *
+ * Ticks are counted as by Network::tick(), so the first tick is 1.
+ */
+class InputBuffer {
+public:
+	InputBuffer(int horizon = 1024);
+
+	//! Schedule a single spike of the given neuron at the given tick
+	void addSpike(int tick, int neuron);
+
+	//! Schedule count spikes, the i-th of neurons[i] at ticks[i], in any order
+	void addSpikes(const int *ticks, const int *neurons, size_t count);
+
+	//! Schedule a spike train of one neuron
+	void addSpikeTrain(int neuron, const int *ticks, size_t count);
+
+	/**
+	 * Add a block of current frames for the ticks [first, first + ticks). The currents for tick
+	 * first + i are at frames[i * stride + j] for the j-th input neuron (in the order in which the
+	 * NL_INPUT neurons have been added to the network). Blocks should be added in time order.
+	 */
+	void addCurrents(const NN_VALUE *frames, int first, int ticks, int stride);
+
+	//! The (sorted) neurons that should fire at the given tick, call with increasing ticks
+	const std::vector<int> & spikes(int tick);
+
+	//! The current frame for the given tick, or NULL, call with increasing ticks
+	const NN_VALUE *currents(int tick);
+
+	//! Number of blocks of current frames that have not been passed yet
+	inline size_t pendingBlocks() { return blocks.size(); }
+
+	//! The last tick for which spikes have been retrieved
+	inline int getTick() { return now; }
+
+private:
+	//! Grow the ring, so that it reaches at least to the given tick
+	void reach(int tick);
+
+	inline std::vector<int> & slot(int tick) { return ring[tick & (ring.size() - 1)]; }
+
+	struct CurrentBlock {
+		const NN_VALUE *frames;
+		int first;
+		int ticks;
+		int stride;
+	};
+
+	//! The ring buffer with scheduled spikes, its size is a power of two
+	std::vector< std::vector<int> > ring;
+
+	//! Blocks of current frames in time order
+	std::deque<CurrentBlock> blocks;
+
+	//! The last tick that has been retrieved
+	int now;
+};
+
+#endif /* INPUTBUFFER_H_ */
@@ -28,61 +28,79 @@
 #include <vector>
 #include <queue>
 #include <Neuron.h>
+#include <NetworkStats.h>
+#include <InputBuffer.h>
 #include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+#include <stdint.h>
 
 struct Synapse;
 
 typedef std::vector<Synapse*> SYNAPSES;
 
-typedef std::deque<bool> HISTORY;
+/**
+ * The spike history of a neuron as a bit mask: bit d is set if the neuron fired d ticks ago. So
+ * advancing it is a shift, and the most recent spike at least d ticks ago is found by counting
+ * the trailing zeros. The first 64 ticks are in one word, a longer history (for a larger maximum
+ * delay, see Network::setMaxDelay) continues in further words.
+ */
+typedef uint64_t HISTORY;
 
+#define HISTORY_BITS 64
+
+//! The default maximum delay, which is also the number of ticks the spikes are remembered
 #define HISTORY_SIZE 20 //16
 
+//! The receptors of which the synaptic state is kept per neuron, see Network::setSynapticDynamics
+enum SynapticReceptor {
+	SR_AMPA,						// excitatory, driven by excitatory synapses
+	SR_GABA,						// inhibitory, driven by inhibitory synapses
+	SR_COUNT
+};
+
 class ConnNeuron {
 public:
 
 	ConnNeuron(int id) {
-		for (int i = 0; i < HISTORY_SIZE; ++i)
-			history.push_back(false);
+		history = 0;
+		older = NULL;
 		input = NN_VALUE(0);
+		for (int r = 0; r < SR_COUNT; ++r)
+			receptor[r] = NN_VALUE(0);
 		this->id = id;
 	}
 	Neuron *neuron;
 	SYNAPSES *outgoing;
 	HISTORY history;
 
+	//! The words after the first one of a history that is longer than 64 ticks (NULL if there
+	//! are none), owned by the network
+	HISTORY *older;
+
 	NN_VALUE input;
 
+	//! The summed, decaying input of all synapses with the same receptor
+	NN_VALUE receptor[SR_COUNT];
+
 	//! An identifier makes things just so easy
 	int id;
 
-	inline bool raised(int delay=0) { return history[delay]; }
-
-	inline void raise() {
-		history[0] = true;
-	}
+	//! The w-th word of the history
+	inline HISTORY & word(int w) { return w ? older[w - 1] : history; }
 
-	inline int first(int delay=0) {
-		for (int i = delay; i < history.size(); ++i) {
-			if (history[i]) return i;
-		}
-		return -1;
+	inline bool raised(int delay=0) {
+		return (word(delay / HISTORY_BITS) >> (delay % HISTORY_BITS)) & 1;
 	}
 
-	void advance() {
-//		print();
-		history.push_front(false);
-		history.pop_back();
-//		print();
+	inline void raise() {
+		history |= 1;
 	}
 
-	void print() {
-//		std::cout << "Spike history [" << id << "]: ";
-		for (int i = 0; i < history.size(); ++i) {
-			std::cout << history[i];
+	void print(int ticks = HISTORY_SIZE) {
+		for (int i = 0; i < ticks; ++i) {
+			std::cout << raised(i);
 		}
-//		std::cout << " and first is " << first(0);
-//		std::cout << std::endl;
 	}
 };
 
@@ -93,24 +111,72 @@ public:
 		weight = NN_VALUE(0);
 		pre = src;
 		post = dest;
+		floor_since = -1;
+		pruned = false;
 	}
 	~Synapse() {};
 	ConnNeuron *pre;
 	ConnNeuron *post;
 	int delay;
 	NN_VALUE weight;
+	//! Tick at the end of which the weight has been at the floor first (-1 if it is not at the
+	//! floor), see Network::setPruning
+	int floor_since;
+	//! A pruned synapse does not deliver anymore and is removed with the next compaction
+	bool pruned;
 };
 
 typedef std::vector<ConnNeuron*> NEURONS;
 
+/**
+ * Base class for observers that can be given to Network::run if the observer has to be chosen
+ * at run time. Any other class or function with the same call signature can be used as well,
+ * in which case the call is resolved at compile time.
+ */
+class SpikeObserver {
+public:
+	virtual ~SpikeObserver() {};
+
+	//! Called with the (sorted) ids of the neurons that fired at tick t
+	virtual void operator()(int t, const std::vector<int> & fired) = 0;
+};
+
+/**
+ * How spikes are delivered over the synapses in a tick. A push visits the outgoing synapses of the
+ * neurons that fired recently, a pull the incoming synapses of those neurons. The result is the
+ * same, only the amount of work differs, see Network::setDelivery.
+ */
+enum DeliveryMode {
+	DM_SCAN,						// all synapses, the reference
+	DM_PUSH,						// outgoing synapses of recently active neurons
+	DM_PULL,						// incoming synapses of recently active neurons
+	DM_AUTO,						// push or pull, whichever visits fewer synapses this tick
+	DM_COUNT
+};
+
+//! How the input that a synapse delivers acts on its post-synaptic neuron
+enum SynapticDynamics {
+	SD_INSTANT,						// during the tick of arrival only
+	SD_CURRENT,						// as a current that decays exponentially
+	SD_CONDUCTANCE,					// as a conductance that decays exponentially
+	SD_COUNT
+};
+
 class Network {
 public:
+	//! Network seeded with the current time
 	Network();
 
-	~Network() {};
+	//! Network with its own seed, so runs can be reproduced
+	Network(long seed);
+
+	~Network();
+
+	//! Reset the random number generator, as srand48 does
+	void seed(long seed);
 
 	//! Add a neuron
-	void addNeuron(NeuronType type, NeuronSign sign, NeuronLocation loc);
+	ConnNeuron *addNeuron(NeuronType type, NeuronSign sign, NeuronLocation loc);
 
 	//! Add a synapse between two neurons
 	void addSynapse(ConnNeuron *src, ConnNeuron *target);
@@ -124,6 +190,55 @@ public:
 	//! Update the entire network
 	void tick();
 
+	//! Run for a number of ticks
+	int run(int ticks);
+
+	/**
+	 * Run for a number of ticks, and call observer(t, fired) for every tick in which at least one
+	 * neuron fired. The loop stays within the network, so nothing is copied per tick.
+	 */
+	template <typename Observer>
+	int run(int ticks, Observer & observer) {
+		for (int i = 0; i < ticks; ++i) {
+			tick();
+			if (!fired.empty()) observer(t, fired);
+		}
+		return ticks;
+	}
+
+	/**
+	 * Run until predicate(t, fired) returns true, but for at most max_ticks. The predicate is
+	 * evaluated after every tick, see StopCondition.h. Returns the number of ticks run.
+	 */
+	template <typename Predicate>
+	int runUntil(Predicate predicate, int max_ticks) {
+		for (int i = 0; i < max_ticks; ++i) {
+			tick();
+			if (predicate(t, fired)) return i + 1;
+		}
+		return max_ticks;
+	}
+
+	//! Same as runUntil, but also call the observer for every tick in which neurons fired
+	template <typename Predicate, typename Observer>
+	int runUntil(Predicate predicate, Observer & observer, int max_ticks) {
+		for (int i = 0; i < max_ticks; ++i) {
+			tick();
+			if (!fired.empty()) observer(t, fired);
+			if (predicate(t, fired)) return i + 1;
+		}
+		return max_ticks;
+	}
+
+	//! Ids of the neurons that fired in the last tick
+	inline const std::vector<int> & getFired() { return fired; }
+
+	//! Drive the network with external input (NULL to disconnect), the caller keeps ownership
+	inline void setInput(InputBuffer *input) { this->input = input; }
+
+	//! The number of ticks so far
+	inline int getTick() { return t; }
+
 	//! Get a fraction of the neurons
 	void getNeurons(std::vector<ConnNeuron*> &subset, float fraction);
 
@@ -139,6 +254,151 @@ public:
 	//! Propagate the spikes over the synapses and adapt the weights
 	void updateSynapses();
 
+	/**
+	 * Choose how spikes are delivered. Only synapses between two neurons that fired within the
+	 * maximum delay can deliver or change, so a push over the outgoing synapses of these
+	 * neurons or a pull over their incoming synapses gives the same result as a scan over all.
+	 * With DM_AUTO (the default) the direction with the fewest synapses to visit is chosen every
+	 * tick, as direction-optimizing breadth-first search does.
+	 */
+	inline void setDelivery(DeliveryMode mode) { delivery = mode; }
+
+	//! The mode that has been used in the last tick (DM_PUSH or DM_PULL for DM_AUTO)
+	inline DeliveryMode getDelivery() { return last_delivery; }
+
+	/**
+	 * Push or pull with all OpenMP threads in ticks in which at least twice the given number of
+	 * synapses is visited (0 disables this), see splitTasks(). The result does not depend on the
+	 * number of threads.
+	 */
+	inline void setParallelGrain(long synapses) { parallel_grain = synapses; }
+
+	/**
+	 * By default a spike that arrives is input to its post-synaptic neuron for one tick only. With
+	 * SD_CURRENT or SD_CONDUCTANCE it is added to the state of the AMPA receptors of the neuron (or
+	 * the GABA receptors for an inhibitory synapse), which decays with the given time constant
+	 * (in ticks). The state is kept per neuron, not per synapse. A spike contributes the same
+	 * charge as with SD_INSTANT, spread out over time. A conductance is scaled to give the same
+	 * current at the resting potential, so GABA inhibits above its reversal potential of -70 mV.
+	 * The current is the one of SD_CURRENT times (E - v) / |E - rest|. For AMPA that is 1 at rest
+	 * and decreases slowly (E - rest is 65 mV), but for GABA E - rest is only 5 mV: at -55 mV it
+	 * inhibits 3 times, and at the peak of a spike 20 times as strongly as with SD_CURRENT. So the
+	 * same current at rest does not mean comparable inhibition. Whether inhibitory synapses deliver
+	 * at all does not depend on the dynamics, see setInhibition().
+	 */
+	void setSynapticDynamics(SynapticDynamics dynamics, NN_VALUE tau_ampa = 5, NN_VALUE tau_gaba = 6);
+
+	/**
+	 * Let inhibitory synapses deliver their spikes, which they do not by default, so that existing
+	 * networks keep their dynamics. They deliver their weight divided by 3, the same factor as for
+	 * excitatory synapses, as input during the tick of arrival or to the GABA state of the target,
+	 * see setSynapticDynamics().
+	 */
+	inline void setInhibition(bool deliver) { inhibition = deliver; }
+
+	/**
+	 * Set the maximum delay of the synapses in ticks: the delays of excitatory synapses that are
+	 * added from now on are drawn from 0 up to this maximum (excluded), and the spikes are kept
+	 * this long for STDP, whose time constant stays 20 ticks. Synapses that already exist must
+	 * have shorter delays. The default is HISTORY_SIZE.
+	 */
+	void setMaxDelay(int ticks);
+
+	//! The maximum delay of the synapses in ticks (excluded)
+	inline int getMaxDelay() { return max_delay; }
+
+	//! Number of neurons in the network
+	inline int getNeuronCount() { return neurons.size() + added_neurons.size(); }
+
+	//! Number of synapses in the network
+	inline long getSynapseCount() { return synapses.size() + added_synapses.size(); }
+
+	/**
+	 * Neurons and synapses that are added while the network runs are kept apart, and are merged
+	 * into the main lists before a tick when there are more than the given number of them (by
+	 * default 1/8 of the synapses, at least 1024).
+	 */
+	void setMergeThreshold(size_t items);
+
+	//! Merge the neurons and synapses that have been added while running into the main lists
+	void merge();
+
+	/**
+	 * Reorder the neurons in memory so that connected neurons are close to each other, by reverse
+	 * Cuthill-McKee on the synapse graph. The neurons are moved into one block in the new order,
+	 * and the synapses are sorted by the positions of their pre- and post-synaptic neurons. The
+	 * ids of the neurons do not change, so spikes, getSpikes() and the input still refer to the
+	 * same neurons, but the synapses (and getWeights) are in another order. The neurons are
+	 * updated in the new order, so a run is equivalent in distribution, not tick by tick.
+	 */
+	void reorder();
+
+	/**
+	 * Move the neurons and synapses into blocks in their current order, without reordering them,
+	 * so the dynamics do not change. The synapses (and getWeights) are grouped by pre-synaptic
+	 * neuron afterwards. Both reorder() and place() divide the blocks over the NUMA nodes in the
+	 * way the OpenMP threads are, so call pinThreads() before.
+	 */
+	void place();
+
+	/**
+	 * Pin every OpenMP thread to a CPU of its own, with the threads spread over the NUMA nodes in
+	 * order: the first threads on the first node, and so on. The calling thread is pinned as well.
+	 */
+	void pinThreads();
+
+	//! The NUMA nodes the blocks of neurons and synapses are on, and the CPUs of the threads
+	void getPlacement(NetworkPlacement & placement);
+
+	//! Position of a neuron in the order of updates
+	inline int getPosition(int id) { return position.empty() ? id : position[id]; }
+
+	//! Bytes of memory occupied by the synapses, including the lists that refer to them
+	size_t getSynapseMemory();
+
+	/**
+	 * Synapse i of all synapses (in the order in which they have been added), 0 <= i <
+	 * getSynapseCount(). The synapses that have been added while running come last, as after a
+	 * merge, but they are not merged, so this can be called while running without cost.
+	 */
+	inline Synapse *getSynapse(long i) {
+		long main = synapses.size();
+		return (i < main) ? synapses[i] : added_synapses[i - main];
+	}
+
+	//! Get the weights of all synapses (in the order in which they have been added)
+	void getWeights(std::vector<NN_VALUE> & weights);
+
+	/**
+	 * A number that changes whenever the synapses (and getWeights) are put in another order, by
+	 * reorder(), place() or compact(). Synapses that are added only extend the order.
+	 */
+	inline long getGeneration() { return generation; }
+
+	/**
+	 * Prune synapses of which the weight stayed at or below the floor for the given number of
+	 * ticks (0 disables pruning): a synapse that drops to the floor in tick t, or that is at the
+	 * floor when it is added or when pruning is enabled after tick t, is pruned in tick t + ticks,
+	 * in every delivery mode. Pruned synapses are skipped immediately and are removed from memory
+	 * every interval ticks, see compact().
+	 */
+	void setPruning(int ticks, NN_VALUE floor = 0, int interval = 1000);
+
+	//! Remove the pruned synapses
+	void compact();
+
+	//! Number of synapses that have been pruned so far
+	inline long getPrunedCount() { return pruned_count; }
+
+	//! Counters and timers, only updated when compiled with NETWORK_STATS
+	inline const NetworkStats & getStats() { return stats; }
+
+	//! Reset all counters and timers
+	inline void resetStats() { stats.clear(); }
+
+	//! Print the statistics to the stream every interval ticks (0 disables it)
+	void setStatsDump(int interval, std::ostream & out = std::cout);
+
 	//! Create a copy of a neuron
 //	Neuron *copy(Neuron *src);
 
@@ -149,12 +409,244 @@ public:
 //	struct Synapse *addSynapse(Neuron *src, Neuron *target);
 
 private:
+	//! The part of the constructors that they have in common
+	void init(long seed);
+
+	//! Start of a part of the synapses that are pushed or pulled in a tick: the index in the list
+	//! of active neurons, and for a push the index in the outgoing synapses of that neuron
+	struct DeliveryTask {
+		DeliveryTask(int active, long synapse): active(active), synapse(synapse) {}
+		int active;
+		long synapse;
+	};
+
+	//! Input for a post-synaptic neuron that is buffered by a task
+	struct Delivered {
+		Delivered(ConnNeuron *post, NN_VALUE input): post(post), input(input) {}
+		ConnNeuron *post;
+		NN_VALUE input;
+	};
+
+	//! Mark a synapse as pruned if its weight has been at the floor long enough
+	void prune(Synapse *synapse);
+
+	//! If a synapse has been at the floor for prune_ticks ticks at the end of the given tick, the
+	//! single rule by which all delivery modes prune
+	inline bool expired(const Synapse *synapse, int tick) {
+		return synapse->floor_since >= 0 && tick - synapse->floor_since >= prune_ticks;
+	}
+
+	/**
+	 * The parts of a tick that use the spike histories are compiled for histories of one word
+	 * (Words = 1), two words, and any number of words (Words = 0), see setMaxDelay().
+	 */
+	template <int Words>
+	void advance();
+
+	template <int Words>
+	void propagate();
+
+	//! Advance the history of a neuron and raise it if it fired
+	template <int Words>
+	void updateSpike(ConnNeuron *cn);
+
+	//! Adapt the weight of a synapse, returns true and the input for its post-synaptic neuron if a
+	//! spike arrives
+	template <int Words>
+	bool updateSynapse(Synapse *synapse, NN_VALUE & delivered, SynapseCounts & counts);
+
+	//! Update all outgoing synapses of an excitatory neuron
+	template <int Words>
+	void updateOutgoing(ConnNeuron *cn, SynapseCounts & counts);
+
+	//! Deliver the spikes of an inhibitory neuron to its targets, see setInhibition()
+	template <int Words>
+	void updateInhibitory(ConnNeuron *cn);
+
+	//! Add the input of an excitatory synapse to its post-synaptic neuron
+	inline void deliver(ConnNeuron *post, NN_VALUE delivered) {
+		if (dynamics == SD_INSTANT) post->input += delivered;
+		else post->receptor[SR_AMPA] += delivered;
+	}
+
+	//! Update the incoming synapses of the neuron at position k that come from active neurons
+	template <int Words>
+	void updateIncoming(int k, SynapseCounts & counts);
+
+	//! Collect the neurons that fired within the maximum delay and the work to push or pull
+	template <int Words>
+	void updateActive(long & push, long & pull);
+
+	//! Build the lists of incoming synapses, in the order in which a scan visits them
+	void updateIncomingLists();
+
+	//! Add a synapse that is added while running to the incoming synapses of its post-synaptic
+	//! neuron, without rebuilding the lists
+	void addIncoming(Synapse *synapse);
+
+	//! Number of incoming synapses of the neuron at position k
+	inline long incomingCount(int k) {
+		long count = 0;
+		if (k + 1 < (int)incoming_offset.size()) count = incoming_offset[k + 1] - incoming_offset[k];
+		if (k < (int)incoming_added.size()) count += incoming_added[k].size();
+		return count;
+	}
+
+	//! Divide the active neurons in tasks with about the same number of synapses, returns the number
+	int splitTasks(long work, bool push);
+
+	//! Push the synapses of a task, the input is buffered
+	template <int Words>
+	void pushTask(size_t i, std::vector<Delivered> & inputs, SynapseCounts & counts);
+
+	//! Pull the synapses of a task
+	template <int Words>
+	void pullTask(size_t i, SynapseCounts & counts);
+
+	//! Mark all synapses that have been at the floor long enough as pruned
+	void sweep();
+
+	//! Update a neuron, the j-th input neuron gets frame[j]
+	void updateNeuron(ConnNeuron *cn, const NN_VALUE *frame, int & j);
+
+	//! Neuron with the given id
+	inline ConnNeuron *neuron(int id) {
+		if (id < (int)neurons.size()) return neurons[getPosition(id)];
+		return added_neurons[id - neurons.size()];
+	}
+
+	//! Neuron at the given position in the order of updates
+	inline ConnNeuron *at(int k) {
+		if (k < (int)neurons.size()) return neurons[k];
+		return added_neurons[k - neurons.size()];
+	}
+
+	//! If a neuron is part of the block that reorder() allocated
+	inline bool inBlock(ConnNeuron *cn) { return cn >= conn_block && cn < conn_block + block_size; }
+
+	//! If a synapse is part of the block that reorder() allocated
+	inline bool inBlock(Synapse *synapse) {
+		return synapse >= synapse_block && synapse < synapse_block + synapse_block_size;
+	}
+
+	//! Move the neurons into blocks in the given order of ids, sort the synapses by post-synaptic
+	//! neuron if asked for
+	void relocate(const std::vector<int> & order, bool sort);
+
+	//! Release the block of neurons
+	void releaseBlock();
+
+	//! Release the block of synapses
+	void releaseSynapseBlock();
+
+	//! Number of added neurons and synapses that triggers a merge
+	inline size_t pendingLimit() {
+		return merge_threshold ? merge_threshold : std::max((size_t)1024, synapses.size() / 8);
+	}
+
+	//! Uniform random number in [0,1) from the generator of this network
+	inline double uniform() { return erand48(rng); }
+
 	NEURONS neurons;
 
 	SYNAPSES synapses;
 
+	//! Neurons and synapses added while running, see merge()
+	NEURONS added_neurons;
+	SYNAPSES added_synapses;
+
+	size_t merge_threshold;
+
+	//! After reorder(): the position of every neuron id and the index of every input neuron in a
+	//! current frame (-1 for other neurons), and the number of input neurons
+	std::vector<int> position;
+	std::vector<int> input_slots;
+	int input_count;
+
+	//! Neurons that have been moved into one block by reorder()
+	ConnNeuron *conn_block;
+	Neuron *neuron_block;
+	size_t block_size;
+
+	//! Synapses that have been moved into one block by reorder()
+	Synapse *synapse_block;
+	size_t synapse_block_size;
+
+	//! Ids of the neurons that fired in the last tick
+	std::vector<int> fired;
+
+	//! Maximum delay, number of words of the spike histories and the mask of the last word
+	int max_delay;
+	int history_words;
+	HISTORY history_mask;
+
+	//! The STDP changes of the weights for every interval up to the maximum delay
+	std::vector<double> stdp_ltd;
+	std::vector<double> stdp_ltp;
+
+	//! How delivered input acts, and the factor by which the receptor state decays every tick
+	SynapticDynamics dynamics;
+	NN_VALUE receptor_decay[SR_COUNT];
+
+	//! Inhibitory synapses deliver their spikes
+	bool inhibition;
+
+	//! How spikes are delivered, and how they have been in the last tick
+	DeliveryMode delivery;
+	DeliveryMode last_delivery;
+
+	//! Positions of the neurons that fired within the maximum delay
+	std::vector<int> active;
+
+	//! The excitatory synapses per post-synaptic neuron (by position), rebuilt when stale
+	SYNAPSES incoming;
+	std::vector<long> incoming_offset;
+	bool incoming_stale;
+
+	//! Excitatory synapses added while running per post-synaptic neuron (by position), in the order
+	//! of a scan, until the lists are rebuilt after the next merge
+	std::vector<SYNAPSES> incoming_added;
+
+	//! Minimum number of synapses per task, the tasks of the current tick and their buffered input
+	long parallel_grain;
+	std::vector<DeliveryTask> tasks;
+	std::vector< std::vector<Delivered> > task_inputs;
+
+	//! Counters of every task, added to the statistics after the tick
+	std::vector<SynapseCounts> task_counts;
+
+	//! External input, for the NL_INPUT neurons in particular
+	InputBuffer *input;
+
 	//! For debugging purposes
 	int t;
+
+	//! State of the random number generator, every network has its own
+	unsigned short rng[3];
+
+	//! Counters and timers of the hot paths
+	NetworkStats stats;
+
+	//! The CPU every OpenMP thread has been pinned to
+	std::vector<int> thread_cpus;
+
+	//! Number of ticks between dumps of the statistics
+	int stats_interval;
+
+	//! Where the statistics are dumped to
+	std::ostream *stats_out;
+
+	//! Pruning: ticks at the floor, the floor and the number of ticks between compactions
+	int prune_ticks;
+	NN_VALUE prune_floor;
+	int compact_interval;
+
+	//! Number of synapses pruned in total, and since the last compaction
+	long pruned_count;
+	long pruned_pending;
+
+	//! Incremented when the order of the synapses changes, see getGeneration()
+	long generation;
 };
 
 
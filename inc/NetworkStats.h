@@ -0,0 +1,209 @@
+/***************************************************************************************************
+ * @brief
+ * @file NetworkStats.h
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+#ifndef NETWORKSTATS_H_
+#define NETWORKSTATS_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <iostream>
+#include <vector>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+//! The phases of a network tick that are timed separately
+enum NetworkPhase {
+	NP_SPIKES,
+	NP_SYNAPSES,
+	NP_NEURONS,
+	NP_UPKEEP,						// merging added items and compaction
+	NP_COUNT						// total number of phases
+};
+
+/**
+ * Cycle counter for timing the phases of a tick. On x86 this is the time stamp counter, which is
+ * cheap enough to read a few times per tick. Elsewhere the monotonic clock in ns is used.
+ */
+inline uint64_t cycles() {
+#if defined(__i386__) || defined(__x86_64__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/**
+ * Counters and timers of the hot paths of the network. They are only updated when the code is
+ * compiled with NETWORK_STATS, otherwise all the STATS_ macros below compile to nothing.
+ */
+struct NetworkStats {
+	//! Cycles spent in every phase of tick()
+	uint64_t cycles[NP_COUNT];
+
+	//! Wall clock time spent in tick() in ns
+	double wall_ns;
+
+	//! Number of ticks
+	long ticks;
+
+	//! Number of spikes
+	long spikes;
+
+	//! Number of spikes delivered over a synapse to a post-synaptic neuron
+	long events;
+
+	//! Number of weight updates on the arrival of a pre-synaptic spike
+	long ltd;
+
+	//! Number of weight updates on the occurrence of a post-synaptic spike
+	long ltp;
+
+	//! Number of times a weight has been clamped at -10 or +10
+	long clamped;
+
+	//! Number of ticks in which the spikes have been pushed, and pulled, see Network::setDelivery
+	long pushes;
+	long pulls;
+
+	NetworkStats() { clear(); }
+
+	void clear() { memset(this, 0, sizeof(NetworkStats)); }
+
+	//! The number capacity planning is based on
+	inline double synapticOpsPerSecond() const {
+		return wall_ns > 0 ? events / (wall_ns * 1e-9) : 0.0;
+	}
+
+	void print(std::ostream & out) const {
+		uint64_t total = 0;
+		for (int p = 0; p < NP_COUNT; ++p) total += cycles[p];
+		out << "ticks=" << ticks << " spikes=" << spikes << " events=" << events
+				<< " ltd=" << ltd << " ltp=" << ltp << " clamped=" << clamped
+				<< " push/pull=" << pushes << "/" << pulls
+				<< " cycles[spikes/synapses/neurons/upkeep]=" << cycles[NP_SPIKES] << "/"
+				<< cycles[NP_SYNAPSES] << "/" << cycles[NP_NEURONS] << "/" << cycles[NP_UPKEEP];
+		if (total > 0) {
+			out << " (" << 100 * cycles[NP_SPIKES] / total << "%/"
+					<< 100 * cycles[NP_SYNAPSES] / total << "%/"
+					<< 100 * cycles[NP_NEURONS] / total << "%/"
+					<< 100 * cycles[NP_UPKEEP] / total << "%)";
+		}
+		out << " synaptic ops/s=" << synapticOpsPerSecond() << std::endl;
+	}
+};
+
+/**
+ * The counters of the synapse updates. Spikes can be delivered by several threads, so every
+ * delivery task counts in its own copy, which is added to the statistics after the tick.
+ */
+struct SynapseCounts {
+	long events;
+	long ltd;
+	long ltp;
+	long clamped;
+
+	SynapseCounts() { clear(); }
+
+	void clear() { events = ltd = ltp = clamped = 0; }
+
+	void add(const SynapseCounts & other) {
+		events += other.events;
+		ltd += other.ltd;
+		ltp += other.ltp;
+		clamped += other.clamped;
+	}
+
+	void addTo(NetworkStats & stats) const {
+		stats.events += events;
+		stats.ltd += ltd;
+		stats.ltp += ltp;
+		stats.clamped += clamped;
+	}
+};
+
+//! Maximum number of NUMA nodes in a placement report
+#define PLACEMENT_NODES 8
+
+/**
+ * Where the memory of a network is: the number of pages of the neuron and the synapse blocks per
+ * NUMA node, see Network::place(), and the CPU and node of every thread.
+ */
+struct NetworkPlacement {
+	//! Pages of the neurons (state and connections) per node
+	long neuron_pages[PLACEMENT_NODES];
+
+	//! Pages of the synapses per node
+	long synapse_pages[PLACEMENT_NODES];
+
+	//! Pages of which the node is not known (not touched yet, or no NUMA support)
+	long unknown_pages;
+
+	//! CPU and node of every thread (-1 if the thread has not been pinned)
+	std::vector<int> cpus;
+	std::vector<int> nodes;
+
+	NetworkPlacement() { clear(); }
+
+	void clear() {
+		memset(neuron_pages, 0, sizeof(neuron_pages));
+		memset(synapse_pages, 0, sizeof(synapse_pages));
+		unknown_pages = 0;
+		cpus.clear();
+		nodes.clear();
+	}
+
+	void print(std::ostream & out) const {
+		out << "pages[neurons/synapses] per node:";
+		for (int n = 0; n < PLACEMENT_NODES; ++n) {
+			if (!neuron_pages[n] && !synapse_pages[n]) continue;
+			out << " " << n << "=" << neuron_pages[n] << "/" << synapse_pages[n];
+		}
+		out << " unknown=" << unknown_pages << " threads[cpu@node]:";
+		for (size_t i = 0; i < cpus.size(); ++i) {
+			out << " " << cpus[i] << "@" << nodes[i];
+		}
+		out << std::endl;
+	}
+};
+
+// counters of synapse updates go to SynapseCounts, the others are only updated by one thread,
+// without NETWORK_STATS the SynapseCounts are still referenced, so they are not unused
+#ifdef NETWORK_STATS
+#define STATS_COUNT(counter, n)		stats.counter += (n)
+#define STATS_COUNT_IN(counts, counter, n)	(counts).counter += (n)
+#define STATS_ADD(counts)			(counts).addTo(stats)
+#define STATS_START(phase)			uint64_t stats_start_##phase = cycles()
+#define STATS_STOP(phase)			stats.cycles[phase] += cycles() - stats_start_##phase
+#else
+#define STATS_COUNT(counter, n)
+#define STATS_COUNT_IN(counts, counter, n)	(void)(counts)
+#define STATS_ADD(counts)			(void)(counts)
+#define STATS_START(phase)
+#define STATS_STOP(phase)
+#endif
+
+#endif /* NETWORKSTATS_H_ */
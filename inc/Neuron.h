@@ -80,6 +80,12 @@ public:
 	//! The neuron did fire in the last update event
 	bool fired();
 
+	//! A neuron that is not updated (e.g. an input neuron without input) should not fire either
+	inline void silence() { spike = false; }
+
+	//! The membrane potential in mV
+	inline NN_VALUE getPotential() const { return v; }
+
 	NeuronLocation getLoc() const {
 		return loc;
 	}
@@ -0,0 +1,126 @@
+/**
+ * @file PPM.h
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+#ifndef PPM_H_
+#define PPM_H_
+
+// General files
+#include <string>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <DataDecorator.h>
+
+/* **************************************************************************************
+ * Interface of PPM
+ * **************************************************************************************/
+
+/**
+ * Colours of values in [0..1]. The range is multiplied by 1020 and divided in four bands, from
+ * blue via cyan, green and yellow to red. The colours are computed once, so a pixel costs a
+ * lookup. Negative values are black, values above 1 are red.
+ */
+class ColourMap {
+public:
+	//! Number of colours in the bands
+	static const int Colours = 1021;
+
+	//! The map is shared, it is never changed after construction
+	static const ColourMap & instance();
+
+	//! Write the colour of the value to rgb[0..2]
+	inline void colour(DC_TYPE value, unsigned char *rgb) const {
+		DC_TYPE scaled = value * (Colours - 1);
+		int index = (scaled >= 0) ? ((scaled < Colours) ? (int)scaled + 1 : Colours + 1) : 0;
+		const unsigned char *c = table[index];
+		rgb[0] = c[0];
+		rgb[1] = c[1];
+		rgb[2] = c[2];
+	}
+
+private:
+	ColourMap();
+
+	//! Black, the colours of the bands and red
+	unsigned char table[Colours + 2][3];
+};
+
+//! The rows are rendered in blocks of about this many bytes, written with a single call each
+const size_t PPMBlockBytes = 1 << 22;
+
+/**
+ * Write an image of width x height pixels as binary PPM. The source is called as source(row,
+ * column) and returns the value of the pixel, see ColourMap. A block of rows is rendered in
+ * parallel into a buffer (with OpenMP, if available), after which the block is written at once.
+ */
+template <typename Source>
+bool WritePPM(const std::string & file, size_t width, size_t height, const Source & source) {
+	FILE *stream = fopen(file.c_str(), "wb");
+	if (stream == NULL) {
+		std::cerr << "Could not open " << file << " for writing" << std::endl;
+		return false;
+	}
+	fprintf(stream, "P6\n%zu %zu\n255\n", width, height);
+
+	const ColourMap & colours = ColourMap::instance();
+	size_t row_bytes = 3 * width;
+	size_t block = std::max((size_t)1, PPMBlockBytes / (row_bytes + 1));
+	std::vector<unsigned char> buffer(std::min(block, height) * row_bytes + 1);
+	bool written = true;
+	for (size_t first = 0; first < height && written; first += block) {
+		long rows = std::min(block, height - first);
+		#pragma omp parallel for schedule(static)
+		for (long r = 0; r < rows; ++r) {
+			unsigned char *rgb = &buffer[r * row_bytes];
+			for (size_t i = 0; i < width; ++i, rgb += 3) {
+				colours.colour(source(first + r, i), rgb);
+			}
+		}
+		written = fwrite(&buffer[0], 1, rows * row_bytes, stream) == rows * row_bytes;
+	}
+	written &= (fclose(stream) == 0);
+	if (!written) std::cerr << "Could not write " << file << std::endl;
+	return written;
+}
+
+/**
+ * A container as source for WritePPM. Its items are laid out column by column (see
+ * DataContainer::addItems), a column of the container is a column of the image.
+ */
+struct ContainerRaster {
+	ContainerRaster(const DataContainer & data): data(data), height(data.height()) {}
+
+	inline DC_TYPE operator()(size_t row, size_t column) const {
+		return data.value(row + column * height);
+	}
+
+	const DataContainer & data;
+	size_t height;
+};
+
+//! Write the container as image, see WritePPM
+bool WritePPM(const std::string & file, const DataContainer & data);
+
+#endif /* PPM_H_ */
@@ -49,8 +49,8 @@ enum PlotType { PT_DEFAULT, PT_DENSITY, PT_CUMULATIVE_DENSITY };
  * In the graph mode we need the following fields for the legend etc.
  */
 struct PLData {
-	PLFLT *x_axis;
-	PLFLT *y_axis;
+	std::vector<PLFLT> x_axis;
+	std::vector<PLFLT> y_axis;
 	int len;
 	PLFLT x_min;
 	PLFLT x_max;
@@ -81,8 +81,14 @@ public:
 	//! Actually draw the plot
 	void Draw(OutputType outputType);
 
-	//! Store the data to file, so we can plot later again
-	void Store();
+	//! Store the data to files, so we can plot later again (also elsewhere)
+	bool Store();
+
+	//! Load the data stored by Store(), returns the number of containers
+	int Load();
+
+	//! Write the grid as it is now to a separate file (with the suffix appended to its name)
+	void Snapshot(const std::string & suffix);
 
 	//! Title on top
 	inline void SetTitle(const std::string & title) { title_label = title; }
@@ -105,6 +111,9 @@ public:
 	//! Set working directory for output and input
 	void SetPath(std::string path);
 
+	//! Number of pixel columns of a graph, series are reduced to at most 4 points per column (0 is all)
+	inline void SetResolution(int columns) { resolution = columns; }
+
 	//! Overwrite the dimensions for graph plotting
 	inline void SetDimensions(double x_min, double x_max, double y_min, double y_max) {
 		dimensions_set = true;
@@ -120,12 +129,24 @@ protected:
 	//! @todo Move to subclass
 	void DrawPPM();
 
+	//! Draw the PPM figure into the given file
+	void DrawPPM(const std::string & file);
+
 	//! Scale depending on the mode
 	PLFLT Scale(const PLFLT input, bool x_axis=true);
 
 	//! Get data from container into arrays
 	void GetData(DataContainer &cont, PLData & pld);
 
+	//! Calculate the minimum and maximum of the arrays
+	void Bounds(PLData & pld);
+
+	//! Reduce the points to the envelope per pixel column between x_min and x_max
+	void Decimate(PLData & pld, PLFLT x_min, PLFLT x_max);
+
+	//! File in which container "index" is stored
+	std::string StoreName(int index);
+
 private:
 	//! Multiple data containers
 	std::vector<DataContainer*> data_v;
@@ -171,6 +192,12 @@ private:
 
 	//! Dimensions themselves
 	PLFLT x_min, x_max, y_min, y_max;
+
+	//! Number of pixel columns for decimation
+	int resolution;
+
+	//! The arrays of the graphs, kept to be reused in the next drawing
+	std::vector<PLData> plds;
 };
 
 #endif /* PLOT_H_ */
@@ -0,0 +1,124 @@
+/**
+ * @file RasterPyramid.h
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+#ifndef RASTERPYRAMID_H_
+#define RASTERPYRAMID_H_
+
+// General files
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <DataDecorator.h>
+
+/* **************************************************************************************
+ * Interface of RasterPyramid
+ * **************************************************************************************/
+
+/**
+ * Spike raster of a long run of a large network at multiple resolutions. At level k a pixel
+ * holds the number of spikes of 2^k neurons in 2^k ticks. Every level is divided in tiles of
+ * tile_ticks x tile_neurons pixels, which are only allocated when a spike falls in them and
+ * are written to disk as soon as the run has passed them. So only a column of tiles per level
+ * is in memory, and an image of any part of the run at any level is rendered from the few
+ * tiles that it covers.
+ *
+ * The directory holds a text file "pyramid" with the dimensions and a file per non-empty tile
+ * "<level>_<column>_<row>.tile" with its counts as raw uint32_t, row (neuron) by row.
+ */
+class RasterPyramid {
+public:
+	//! Pyramid in the given directory, call create() to record or load() to render
+	RasterPyramid(const std::string & directory);
+
+	//! Writes the tiles that are still in memory
+	~RasterPyramid();
+
+	//! Start a new pyramid, the tile sizes should be powers of two
+	void create(int neurons, int levels = 10, int tile_ticks = 256, int tile_neurons = 256);
+
+	//! Read the dimensions of an existing pyramid
+	bool load();
+
+	//! Add the spikes of a tick, ticks should not decrease (can be used as observer for Network::run)
+	void operator()(int tick, const std::vector<int> & fired);
+
+	//! Write all tiles in memory and the dimensions to disk
+	void flush();
+
+	/**
+	 * Render the given ticks and neurons at the given level as image. A pixel gets the number
+	 * of spikes times gain, divided by the number of neurons and ticks it covers, see ColourMap.
+	 * With gain 0 the counts are scaled such that the maximum in the tiles it covers is 1.
+	 */
+	bool render(const std::string & file, int level, long first_tick, long ticks,
+			int first_neuron, int neurons, DC_TYPE gain = 0);
+
+	//! Number of levels
+	inline int levels() const { return level_count; }
+
+	//! Number of ticks recorded
+	inline long ticks() const { return last_tick + 1; }
+
+	//! Number of neurons
+	inline int neurons() const { return neuron_count; }
+
+private:
+	//! Name of a tile file
+	std::string tileName(int level, long column, long row) const;
+
+	//! Get a tile of the open column of a level, created or read back from disk
+	uint32_t *openTile(int level, long column, long row);
+
+	//! Read a tile from disk, false if it does not exist (it has no spikes)
+	bool readTile(int level, long column, long row, std::vector<uint32_t> & tile) const;
+
+	//! Write and release the tiles of the open column of a level
+	void closeColumn(int level);
+
+	//! Write the dimensions
+	void writeDimensions() const;
+
+	std::string directory;
+
+	int neuron_count;
+
+	int level_count;
+
+	//! Tile size and its log2
+	int tile_ticks;
+	int tile_neurons;
+	int ticks_shift;
+	int neurons_shift;
+
+	long last_tick;
+
+	//! If spikes are being recorded
+	bool recording;
+
+	//! Per level the column of tiles in memory, and its tiles per row (NULL if it has no spikes)
+	std::vector<long> open_column;
+	std::vector< std::vector<uint32_t*> > open;
+};
+
+#endif /* RASTERPYRAMID_H_ */
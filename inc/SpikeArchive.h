@@ -0,0 +1,210 @@
+/**
+ * @file SpikeArchive.h
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+#ifndef SPIKEARCHIVE_H_
+#define SPIKEARCHIVE_H_
+
+// General files
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+#include <Varint.h>
+
+/* **************************************************************************************
+ * Interface of SpikeArchive
+ * **************************************************************************************/
+
+/**
+ * Header of a block in a spike archive. It is followed by the bitmap (bitmap_words uint64_t) and
+ * the payload. The payload holds per tick with spikes: the distance to the previous tick (to
+ * first_tick for the first one), the number of spikes and the neuron ids, sorted, each as the
+ * distance to the previous one, all as varints.
+ */
+struct SpikeBlock {
+	int64_t first_tick;
+	int64_t last_tick;
+	uint32_t ticks;
+	uint32_t spikes;
+	uint32_t payload;
+	uint32_t bitmap_words;
+};
+
+//! Entry of the time index at the end of an archive, one per block
+struct SpikeIndex {
+	int64_t first_tick;
+	int64_t last_tick;
+	uint64_t offset;
+};
+
+/**
+ * Trailer of an archive. The file starts with the same magic, the number of neurons and the
+ * number of bits in the bitmaps, as the trailer without index fields.
+ */
+struct SpikeTrailer {
+	char magic[4];					// "SPKA"
+	uint32_t version;
+	uint32_t neurons;
+	uint32_t bitmap_bits;
+	uint64_t index_offset;
+	uint64_t blocks;
+};
+
+/**
+ * Archive of the spikes of a run, used as observer for Network::run. The spikes are packed in
+ * blocks of about block_bytes, and every block has a bitmap in which a bit stands for a range of
+ * neurons of which at least one spiked in the block (without bitmaps if bitmap_bits is 0). When
+ * the archive is closed, an index with the ticks of every block is appended.
+ */
+class SpikeArchive {
+public:
+	//! Archive in the given file, bitmap_bits should be a multiple of 64
+	SpikeArchive(const std::string & file, int neurons, size_t block_bytes = 1 << 16, int bitmap_bits = 256);
+
+	//! Closes the archive
+	~SpikeArchive();
+
+	//! If the file could be created
+	inline bool good() const { return stream != NULL; }
+
+	//! Add the spikes of a tick, ticks should increase
+	void operator()(int tick, const std::vector<int> & fired);
+
+	//! Write the last block and the index
+	void close();
+
+private:
+	//! Write the current block
+	void writeBlock();
+
+	FILE *stream;
+
+	int neurons;
+
+	size_t block_bytes;
+
+	int bitmap_bits;
+
+	//! The block being filled
+	SpikeBlock block;
+	std::vector<uint64_t> bitmap;
+	std::vector<uint8_t> payload;
+
+	int64_t last_tick;
+
+	//! Sorted copy of spikes that were not sorted
+	std::vector<int> sorted;
+
+	std::vector<SpikeIndex> index;
+
+	uint64_t offset;
+};
+
+/**
+ * Reads an archive written by SpikeArchive. The file is mapped into memory, so a query only
+ * touches the pages of the index and of the blocks in its range of ticks, of which the blocks
+ * without spikes of the neurons in its range are skipped by their bitmap.
+ */
+class SpikeArchiveReader {
+public:
+	SpikeArchiveReader();
+
+	~SpikeArchiveReader();
+
+	//! Open an archive, returns false if it is not one (or not closed)
+	bool open(const std::string & file);
+
+	//! Number of neurons
+	inline int getNeurons() const { return trailer.neurons; }
+
+	//! Number of blocks
+	inline long getBlocks() const { return trailer.blocks; }
+
+	//! Number of blocks that have been decoded in the last query
+	inline long getTouched() const { return touched; }
+
+	/**
+	 * Call observer(tick, neurons) for every tick in [first_tick, last_tick] with spikes of the
+	 * neurons in [first_neuron, last_neuron], with those neurons (sorted). Returns the number of
+	 * spikes. A block that is corrupt ends the query.
+	 */
+	template <typename Observer>
+	long query(int64_t first_tick, int64_t last_tick, int first_neuron, int last_neuron, Observer & observer) {
+		touched = 0;
+		long spikes = 0;
+		for (long b = firstBlock(first_tick); b < (long)trailer.blocks; ++b) {
+			if (index[b].first_tick > last_tick) break;
+			const SpikeBlock & block = *(const SpikeBlock*)(data + index[b].offset);
+			const uint64_t *bits = (const uint64_t*)(&block + 1);
+			if (!overlaps(bits, block.bitmap_words, first_neuron, last_neuron)) continue;
+			++touched;
+			const uint8_t *in = (const uint8_t*)(bits + block.bitmap_words);
+			const uint8_t *end = in + block.payload;
+			int64_t tick = block.first_tick;
+			uint64_t distance, count;
+			for (uint32_t t = 0; t < block.ticks; ++t) {
+				if (!getVarint(in, end, distance) || !getVarint(in, end, count)) return spikes;
+				tick += distance;
+				if (tick > last_tick) return spikes;
+				bool wanted = tick >= first_tick;
+				neurons.clear();
+				int64_t neuron = 0;
+				for (uint64_t i = 0; i < count; ++i) {
+					if (!getVarint(in, end, distance)) return spikes;
+					neuron += distance;
+					if (wanted && neuron >= first_neuron && neuron <= last_neuron) neurons.push_back(neuron);
+				}
+				if (!neurons.empty()) {
+					spikes += neurons.size();
+					observer(tick, neurons);
+				}
+			}
+		}
+		return spikes;
+	}
+
+private:
+	//! First block that ends at or after the tick
+	long firstBlock(int64_t tick) const;
+
+	//! If a block has spikes of neurons in the range according to its bitmap
+	bool overlaps(const uint64_t *bits, uint32_t words, int first_neuron, int last_neuron) const;
+
+	//! Release the mapping
+	void close();
+
+	const uint8_t *data;
+
+	size_t size;
+
+	SpikeTrailer trailer;
+
+	const SpikeIndex *index;
+
+	long touched;
+
+	std::vector<int> neurons;
+};
+
+#endif /* SPIKEARCHIVE_H_ */
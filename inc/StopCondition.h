@@ -0,0 +1,86 @@
+/***************************************************************************************************
+ * @brief
+ * @file StopCondition.h
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+#ifndef STOPCONDITION_H_
+#define STOPCONDITION_H_
+
+#include <vector>
+
+/**
+ * Stopping conditions for Network::runUntil. They are evaluated after every tick with the ids of
+ * the neurons that fired, so they should be cheap.
+ */
+
+/**
+ * Stop when the population rate, the fraction of neurons that fire in one tick, reaches the
+ * threshold. Use it to detect runaway synchronization.
+ */
+struct StopOnRate {
+	StopOnRate(int neurons, double rate): threshold(neurons * rate) {}
+
+	inline bool operator()(int, const std::vector<int> & fired) {
+		return fired.size() >= threshold;
+	}
+
+	double threshold;
+};
+
+/**
+ * Stop when the network has been silent for a number of consecutive ticks.
+ */
+struct StopOnSilence {
+	StopOnSilence(int ticks): ticks(ticks), silent(0) {}
+
+	inline bool operator()(int, const std::vector<int> & fired) {
+		silent = fired.empty() ? silent + 1 : 0;
+		return silent >= ticks;
+	}
+
+	int ticks;
+	int silent;
+};
+
+/**
+ * Stop when either of two conditions holds.
+ */
+template <typename A, typename B>
+struct StopOnEither {
+	StopOnEither(A a, B b): a(a), b(b) {}
+
+	inline bool operator()(int t, const std::vector<int> & fired) {
+		// evaluate both, conditions can have state
+		bool stop_a = a(t, fired);
+		bool stop_b = b(t, fired);
+		return stop_a || stop_b;
+	}
+
+	A a;
+	B b;
+};
+
+//! Combine two stopping conditions
+template <typename A, typename B>
+StopOnEither<A,B> stopOnEither(A a, B b) {
+	return StopOnEither<A,B>(a, b);
+}
+
+#endif /* STOPCONDITION_H_ */
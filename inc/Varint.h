@@ -0,0 +1,69 @@
+/**
+ * @file Varint.h
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+#ifndef VARINT_H_
+#define VARINT_H_
+
+// General files
+#include <vector>
+#include <stdint.h>
+
+/* **************************************************************************************
+ * Variable length integers
+ * **************************************************************************************/
+
+//! Append an unsigned varint: 7 bits per byte, the high bit is set if more bytes follow
+inline void putVarint(std::vector<uint8_t> & out, uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((uint8_t)value);
+}
+
+//! Signed values are zigzag encoded, so small negative values are small as well
+inline void putSigned(std::vector<uint8_t> & out, int64_t value) {
+	putVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+//! Read a varint and advance the pointer, returns false at the end of the data
+inline bool getVarint(const uint8_t *& in, const uint8_t *end, uint64_t & value) {
+	value = 0;
+	for (int shift = 0; in < end && shift < 64; shift += 7) {
+		uint8_t byte = *in++;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return true;
+	}
+	return false;
+}
+
+//! Read a zigzag encoded varint
+inline bool getSigned(const uint8_t *& in, const uint8_t *end, int64_t & value) {
+	uint64_t zigzag;
+	if (!getVarint(in, end, zigzag)) return false;
+	value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+	return true;
+}
+
+#endif /* VARINT_H_ */
@@ -0,0 +1,157 @@
+/**
+ * @file WeightJournal.h
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+#ifndef WEIGHTJOURNAL_H_
+#define WEIGHTJOURNAL_H_
+
+// General files
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+#include <Network.h>
+
+/* **************************************************************************************
+ * Interface of WeightJournal
+ * **************************************************************************************/
+
+//! Kinds of frames in a journal
+enum JournalFrame {
+	JF_KEY,							// all weights
+	JF_DELTA,						// only the weights that changed since the previous frame
+	JF_COUNT
+};
+
+/**
+ * Journal of the evolution of the synaptic weights. The weights are quantized and a frame holds
+ * only the ones of which the quantized value changed since the previous frame: the distance to
+ * the index of the previous change and the difference in value, both as varints. Every so many
+ * frames, and whenever the number or the order of the synapses changes, a key frame holds all
+ * weights, so that the weights at any recorded tick can be reconstructed from the last key frame
+ * before it.
+ *
+ * The file starts with a header (magic, version and quantum) followed by the frames, each a kind
+ * byte, the tick and the payload length (varints) and the payload.
+ */
+class WeightJournal {
+public:
+	//! Journal to the given file, weights are stored in multiples of quantum
+	WeightJournal(const std::string & file, NN_VALUE quantum = 0.01, int key_interval = 100);
+
+	//! Closes the file
+	~WeightJournal();
+
+	//! If the file could be created
+	inline bool good() const { return stream != NULL; }
+
+	//! Record the weights at the given tick, as a key frame if asked for (e.g. because the order of
+	//! the weights has changed)
+	void record(int tick, const std::vector<NN_VALUE> & weights, bool key = false);
+
+	//! Record the weights of the network at its current tick
+	void record(Network & network);
+
+	//! Write everything that is buffered to the file
+	void flush();
+
+	//! Number of frames written
+	inline long frames() const { return frame_count; }
+
+	//! Number of bytes written
+	inline long bytes() const { return byte_count; }
+
+private:
+	//! Write a frame
+	void write(JournalFrame kind, int tick);
+
+	FILE *stream;
+
+	NN_VALUE quantum;
+
+	int key_interval;
+
+	//! The quantized weights as recorded in the last frame
+	std::vector<int32_t> last;
+
+	//! Payload of the frame being written
+	std::vector<uint8_t> payload;
+
+	//! Weights of the network to be recorded
+	std::vector<NN_VALUE> weights;
+
+	//! Generation of the order of the synapses of the network in the last frame
+	long generation;
+
+	long frame_count;
+
+	long byte_count;
+};
+
+/**
+ * Reads a journal written by WeightJournal. When it is opened only the headers of the frames are
+ * read, to know where every frame starts.
+ */
+class WeightJournalReader {
+public:
+	WeightJournalReader();
+
+	~WeightJournalReader();
+
+	//! Open a journal, returns false if it is not one
+	bool open(const std::string & file);
+
+	//! Number of frames
+	inline int frames() const { return index.size(); }
+
+	//! Tick of a frame
+	inline int tick(int frame) const { return index[frame].tick; }
+
+	/**
+	 * The weights as recorded in the last frame at or before the given tick, returns the tick of
+	 * that frame, or -1 if there is none.
+	 */
+	int reconstruct(int tick, std::vector<NN_VALUE> & weights);
+
+private:
+	//! Position and kind of a frame in the file
+	struct FrameIndex {
+		int tick;
+		JournalFrame kind;
+		long offset;
+		size_t size;
+	};
+
+	//! Apply a frame to the quantized weights
+	bool apply(const FrameIndex & frame, std::vector<int32_t> & weights);
+
+	FILE *stream;
+
+	NN_VALUE quantum;
+
+	std::vector<FrameIndex> index;
+
+	std::vector<uint8_t> payload;
+};
+
+#endif /* WEIGHTJOURNAL_H_ */
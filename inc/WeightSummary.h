@@ -0,0 +1,107 @@
+/**
+ * @file WeightSummary.h
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+#ifndef WEIGHTSUMMARY_H_
+#define WEIGHTSUMMARY_H_
+
+// General files
+#include <vector>
+#include <iostream>
+#include <Network.h>
+#include <Histogram.h>
+#include <DataDecorator.h>
+
+/* **************************************************************************************
+ * Interface of WeightSummary
+ * **************************************************************************************/
+
+/**
+ * Histograms of the synaptic weights per delay and per pair of populations (pre, post), all
+ * collected in one pass over the synapses, in parallel with OpenMP. The populations are the
+ * excitatory and inhibitory neurons, or blocks of consecutive neuron ids. The summaries can be
+ * put in a DataContainer and drawn with Plot as a grid (PL_GRID).
+ */
+class WeightSummary {
+public:
+	//! Weights binned in [min, max), populations of block neurons (0 for excitatory/inhibitory)
+	WeightSummary(int bins = 100, NN_VALUE min = -10, NN_VALUE max = 10, int block = 0);
+
+	//! Collect the weights of the network, pruned synapses that are not removed yet are skipped
+	void summarize(Network & network);
+
+	//! Histogram of the weights of synapses with the given delay
+	inline const Histogram & delay(int delay) const { return delays[delay]; }
+
+	//! Histogram of the weights of synapses from population pre to population post
+	inline const Histogram & pair(int pre, int post) const { return pairs[pre * populations + post]; }
+
+	//! Mean weight from population pre to population post (0 without synapses)
+	NN_VALUE mean(int pre, int post) const;
+
+	//! Number of populations
+	inline int getPopulations() const { return populations; }
+
+	/**
+	 * A column per delay with the histogram of the weights, highest weights on top. Every column
+	 * is scaled to its maximum count, so the shape of the distribution is visible for each delay.
+	 */
+	void getDelayGrid(DataContainer & grid) const;
+
+	//! The mean weight per pair, scaled from [min, max) to [0,1), a column per pre population
+	void getPairGrid(DataContainer & grid) const;
+
+	//! Print the mean weight per pair
+	void print(std::ostream & out) const;
+
+private:
+	//! Population of a neuron
+	inline int population(const ConnNeuron *neuron) const {
+		if (block) return neuron->id / block;
+		return neuron->neuron->getSign() == NS_EXCITATORY ? 0 : 1;
+	}
+
+	int bins;
+
+	NN_VALUE min;
+
+	NN_VALUE max;
+
+	int block;
+
+	int populations;
+
+	std::vector<Histogram> delays;
+
+	std::vector<Histogram> pairs;
+
+	//! Sum of the weights per pair, for the mean
+	std::vector<double> sums;
+
+	//! The histograms and sums of every thread, kept between calls
+	std::vector< std::vector<Histogram> > thread_delays;
+	std::vector< std::vector<Histogram> > thread_pairs;
+	std::vector< std::vector<double> > thread_sums;
+};
+
+#endif /* WEIGHTSUMMARY_H_ */
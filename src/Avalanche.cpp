@@ -0,0 +1,131 @@
+/**
+ * @file Avalanche.cpp
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+// General files
+#include <Avalanche.h>
+#include <math.h>
+#include <assert.h>
+
+using namespace std;
+
+//! Values up to 10^MaxDecades fit in the histograms
+const int MaxDecades = 12;
+
+/* **************************************************************************************
+ * Implementation of PowerLawFit
+ * **************************************************************************************/
+
+void PowerLawFit::add(long x) {
+	if (x < x_min) return;
+	++n;
+	sum += log(x / (x_min - 0.5));
+}
+
+double PowerLawFit::exponent() const {
+	if (n == 0 || sum <= 0) return 0;
+	return 1 + n / sum;
+}
+
+double PowerLawFit::error() const {
+	if (n == 0 || sum <= 0) return 0;
+	return (exponent() - 1) / sqrt((double)n);
+}
+
+/* **************************************************************************************
+ * Implementation of Avalanche
+ * **************************************************************************************/
+
+Avalanche::Avalanche(int threshold, int bin, int bins_per_decade):
+		threshold(threshold), bin(bin),
+		size_histogram(HS_LOG, 1, pow(10.0, MaxDecades), MaxDecades * bins_per_decade),
+		duration_histogram(HS_LOG, 1, pow(10.0, MaxDecades), MaxDecades * bins_per_decade) {
+	assert (bin > 0 && bins_per_decade > 0);
+	bin_ticks = 0;
+	bin_spikes = 0;
+	size = duration = 0;
+	last_tick = 0;
+	avalanches = 0;
+}
+
+void Avalanche::setMinimum(long size_min, long duration_min) {
+	size_fit = PowerLawFit(size_min);
+	duration_fit = PowerLawFit(duration_min);
+}
+
+void Avalanche::add(int spikes) {
+	bin_spikes += spikes;
+	if (++bin_ticks == bin) endBin();
+}
+
+/**
+ * Silence only has to be walked through tick by tick as long as it ends an avalanche or the
+ * current bin.
+ */
+void Avalanche::addSilence(long ticks) {
+	while (ticks > 0 && (bin_ticks > 0 || duration > 0)) {
+		add(0);
+		--ticks;
+	}
+	// the rest consists of complete quiet bins, apart from the last one
+	if (ticks > 0) bin_ticks = ticks % bin;
+}
+
+void Avalanche::operator()(int t, const std::vector<int> & fired) {
+	if (t - last_tick > 1) addSilence(t - last_tick - 1);
+	add(fired.size());
+	last_tick = t;
+}
+
+/**
+ * If the bin is active, the avalanche continues (or starts). If it is quiet, an ongoing
+ * avalanche is over and ends up in the histograms.
+ */
+void Avalanche::endBin() {
+	if (bin_spikes > (long)threshold * bin) {
+		size += bin_spikes;
+		++duration;
+	} else {
+		flush();
+	}
+	bin_ticks = 0;
+	bin_spikes = 0;
+}
+
+void Avalanche::flush() {
+	if (duration == 0) return;
+	++avalanches;
+	size_histogram.add(size);
+	duration_histogram.add(duration);
+	size_fit.add(size);
+	duration_fit.add(duration);
+	size = duration = 0;
+}
+
+void Avalanche::print(std::ostream & out) const {
+	out << "Avalanches: " << avalanches
+			<< ", size exponent " << size_fit.exponent() << " +/- " << size_fit.error()
+			<< " (n=" << size_fit.n << ", x_min=" << size_fit.x_min << ")"
+			<< ", duration exponent " << duration_fit.exponent() << " +/- " << duration_fit.error()
+			<< " (n=" << duration_fit.n << ", x_min=" << duration_fit.x_min << ")" << endl;
+}
@@ -24,11 +24,18 @@
 
 // General files
 #include <iostream>
-#include <locale>
+#include <limits.h>
 #include <vector>
 #include <assert.h>
 #include <cmath>
 #include <stdio.h>
+#include <algorithm>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 #include <DataDecorator.h>
 #include <EventCounter.hpp>
@@ -39,12 +46,17 @@ using namespace std;
  * Implementation of DataContainer
  * **************************************************************************************/
 
-DataContainer::DataContainer(): id(-1) {
+DataContainer::DataContainer(): id(-1), layout(DL_COLUMNS), count(0), data_height(0),
+		columns(0), window(0), first_column(0), decimation(0), decimated_columns(0),
+		decimated_x(0), history(NULL), x_data(NULL), y_data(NULL), value_data(NULL),
+		bit_data(NULL), column_x_data(NULL), mapping(NULL), mapping_size(0) {
 //	deallocate = false;
 //	float_data = NULL;
 }
 
 DataContainer::~DataContainer() {
+	unmap();
+	delete history;
 //	if (deallocate) {
 //		if (float_data != NULL) {
 //			delete [] float_data;
@@ -81,63 +93,443 @@ DataContainer::~DataContainer() {
 //	return alpha;
 //}
 
+void DataContainer::setLayout(DataLayout layout) {
+	if (this->layout == layout) return;
+	assert (count == 0);
+	this->layout = layout;
+}
+
+//! Reserve memory for the given number of items
+void DataContainer::reserve(size_t items) {
+	switch (layout) {
+	case DL_COLUMNS:
+		coord_x.reserve(items);
+		coord_y.reserve(items);
+		values.reserve(items);
+		break;
+	case DL_BITS:
+		bits.reserve((items + 63) / 64);
+		break;
+	}
+}
+
+void DataContainer::setWindow(int columns, int decimation, int history_columns) {
+	assert (count == 0 && columns > 0);
+	window = columns;
+	this->decimation = decimation;
+	delete history;
+	history = NULL;
+	if (decimation > 0) {
+		history = new DataContainer();
+		history->setWindow(history_columns > 0 ? history_columns : columns);
+	}
+}
+
 /**
- * The number of data elements
+ * Without a window, or as long as the window is not full, the arrays are extended. Otherwise the
+ * oldest column is overwritten and the next one becomes the oldest.
  */
-int DataContainer::size() {
-	return data_items.size();
-//	switch(dataType) {
-//	case DT_MAP: assert (map_data != NULL); return map_data->size();
-//	case DT_F2DARRAY: return float_data_len;
-//	default:
-//		cerr << "Size: Unknown data type" << endl;
-//		break;
-//	}
-//	return -1;
+size_t DataContainer::appendColumn(int height, int xcoord) {
+	assert (!mapping);
+	assert (!window || !columns || height == data_height);
+	data_height = height;
+	size_t base = count;
+	if (!window || columns < window) {
+		++columns;
+		count += height;
+		if (layout == DL_BITS) {
+			bits.resize((count + 63) / 64, 0);
+			column_x.push_back(xcoord);
+		} else {
+			coord_x.resize(count);
+			coord_y.resize(count);
+			values.resize(count);
+		}
+		sync();
+		return base;
+	}
+	int column = first_column;
+	if (history != NULL) decimate(column);
+	first_column = (first_column + 1) % window;
+	base = (size_t)column * height;
+	if (layout == DL_BITS) {
+		for (size_t i = base; i < base + height; ++i) {
+			bits[i >> 6] &= ~((uint64_t)1 << (i & 63));
+		}
+		column_x[column] = xcoord;
+	}
+	return base;
+}
+
+void DataContainer::decimate(int column) {
+	size_t base = (size_t)column * data_height;
+	if (decimated_columns == 0) {
+		decimated.assign(data_height, 0);
+		decimated_x = (layout == DL_BITS) ? column_x_data[column] : x_data[base];
+	}
+	for (int i = 0; i < data_height; ++i) {
+		size_t index = base + i;
+		if (layout == DL_BITS)
+			decimated[i] += (bit_data[index >> 6] >> (index & 63)) & 1;
+		else
+			decimated[i] += value_data[index];
+	}
+	if (++decimated_columns == decimation) {
+		for (int i = 0; i < data_height; ++i) {
+			decimated[i] /= decimation;
+		}
+		history->addItems(&decimated[0], data_height, decimated_x);
+		decimated_columns = 0;
+	}
 }
 
 //! Add a data item
-void DataContainer::addItem(DataItem *item) {
-	data_items.push_back(item);
+void DataContainer::addItem(const DataItem & item) {
+	assert (!window && !mapping);
+	setLayout(DL_COLUMNS);
+	coord_x.push_back(item.coord_x);
+	coord_y.push_back(item.coord_y);
+	values.push_back(item.value);
+	++count;
+	sync();
 }
 
 //! Add a series of items
 void DataContainer::addItems(std::map<DC_TYPE,int> & items) {
+	assert (!window && !mapping);
+	setLayout(DL_COLUMNS);
 	data_height = items.size();
 	std::map<DC_TYPE,int>::iterator it;
 	for (it = items.begin(); it != items.end(); ++it) {
-		DataItem* item = new DataItem();
-		item->coord_y = it->second;
-		item->value = it->first;
-		data_items.push_back(item);
+		coord_x.push_back(0);
+		coord_y.push_back(it->second);
+		values.push_back(it->first);
 	}
+	count += items.size();
+	sync();
 }
 
 //! Add a series of items
 void DataContainer::addItems(std::vector<DC_TYPE> & items, int xcoord) {
-	data_height = items.size();
-	for (int i = 0; i < items.size(); ++i) {
-		DataItem* item = new DataItem();
-		item->coord_x = xcoord;
-		item->coord_y = i;
-		item->value = items[i];
-		data_items.push_back(item);
+	if (items.empty()) return;
+	addItems(&items[0], items.size(), xcoord);
+}
+
+//! Add a column of items, the arrays are extended once
+void DataContainer::addItems(const DC_TYPE *items, size_t count, int xcoord) {
+	setLayout(DL_COLUMNS);
+	size_t base = appendColumn(count, xcoord);
+	for (size_t i = 0; i < count; ++i) {
+		coord_x[base + i] = xcoord;
+		coord_y[base + i] = i;
 	}
+	std::copy(items, items + count, values.begin() + base);
+}
 
+/**
+ * The bits are appended to the end of the raster, so columns are not aligned on words.
+ */
+void DataContainer::addItems(const std::vector<bool> & items, int xcoord) {
+	setLayout(DL_BITS);
+	assert (column_x.empty() || (int)items.size() == data_height);
+	size_t base = appendColumn(items.size(), xcoord);
+	for (size_t i = 0; i < items.size(); ++i) {
+		size_t index = base + i;
+		if (items[i]) bits[index >> 6] |= (uint64_t)1 << (index & 63);
+	}
 }
 
-DataItem * DataContainer::getItem(int index) {
-	assert (data_items.size() > index);
-	return data_items[index];
+DataItem DataContainer::getItem(size_t index) const {
+	assert (index < count);
+	DataItem item;
+	item.value = value(index);
+	index = physical(index);
+	if (layout == DL_BITS) {
+		item.coord_x = column_x_data[index / data_height];
+		item.coord_y = index % data_height;
+	} else {
+		item.coord_x = x_data[index];
+		item.coord_y = y_data[index];
+	}
+	return item;
 }
 
 //! Remove all items
 void DataContainer::clear() {
-	DC_DATA_ITEMS::iterator it;
-	for (it = data_items.begin(); it != data_items.end(); ++it) {
-		delete (*it);
+	unmap();
+	coord_x.clear();
+	coord_y.clear();
+	values.clear();
+	bits.clear();
+	column_x.clear();
+	count = 0;
+	columns = 0;
+	first_column = 0;
+	decimated_columns = 0;
+	if (history != NULL) history->clear();
+	sync();
+}
+
+void DataContainer::sync() {
+	x_data = coord_x.empty() ? NULL : &coord_x[0];
+	y_data = coord_y.empty() ? NULL : &coord_y[0];
+	value_data = values.empty() ? NULL : &values[0];
+	bit_data = bits.empty() ? NULL : &bits[0];
+	column_x_data = column_x.empty() ? NULL : &column_x[0];
+}
+
+void DataContainer::unmap() {
+	if (mapping == NULL) return;
+	munmap(mapping, mapping_size);
+	mapping = NULL;
+	mapping_size = 0;
+}
+
+void DataContainer::header(DataFileHeader & header) const {
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "DCNT", 4);
+	header.byte_order = DataFileByteOrder;
+	header.version = DataFileVersion;
+	header.layout = layout;
+	header.id = id;
+	header.height = data_height;
+	header.count = count;
+	header.columns = (layout == DL_BITS) ? columns : 0;
+}
+
+/**
+ * Without a window, or as long as it did not wrap around, the arrays are written as they are.
+ * Otherwise the columns from first_column on come first. The bits of a column are not aligned on
+ * words, so a wrapped raster is copied in logical order into the scratch buffer.
+ */
+void DataContainer::segments(std::vector< std::pair<const void*,size_t> > & parts,
+		std::vector<uint64_t> & scratch) const {
+	parts.clear();
+	if (!count) return;
+	size_t split = (size_t)first_column * data_height;
+	if (layout == DL_COLUMNS) {
+		const void *arrays[3] = { value_data, x_data, y_data };
+		size_t sizes[3] = { sizeof(DC_TYPE), sizeof(int32_t), sizeof(int32_t) };
+		for (int a = 0; a < 3; ++a) {
+			const char *data = (const char*)arrays[a];
+			parts.push_back(make_pair(data + split * sizes[a], (count - split) * sizes[a]));
+			if (split) parts.push_back(make_pair(data, split * sizes[a]));
+		}
+		return;
+	}
+	size_t words = (count + 63) / 64;
+	if (!split) {
+		parts.push_back(make_pair(bit_data, words * sizeof(uint64_t)));
+	} else {
+		scratch.assign(words, 0);
+		for (size_t i = 0; i < count; ++i) {
+			size_t index = physical(i);
+			if ((bit_data[index >> 6] >> (index & 63)) & 1) scratch[i >> 6] |= (uint64_t)1 << (i & 63);
+		}
+		parts.push_back(make_pair(&scratch[0], words * sizeof(uint64_t)));
 	}
-	data_items.clear();
+	parts.push_back(make_pair(column_x_data + first_column, (columns - first_column) * sizeof(int32_t)));
+	if (first_column) parts.push_back(make_pair(column_x_data, first_column * sizeof(int32_t)));
+}
+
+/**
+ * Sizes of the arrays that follow the header, the total is returned.
+ */
+static size_t arraySizes(const DataFileHeader & header, size_t *sizes) {
+	if (header.layout == DL_BITS) {
+		sizes[0] = (header.count + 63) / 64 * sizeof(uint64_t);
+		sizes[1] = header.columns * sizeof(int32_t);
+		sizes[2] = 0;
+	} else {
+		sizes[0] = header.count * sizeof(DC_TYPE);
+		sizes[1] = sizes[2] = header.count * sizeof(int32_t);
+	}
+	return sizes[0] + sizes[1] + sizes[2];
+}
+
+/**
+ * Used by read() and map(), after it the arrays can be sized and indexed without further checks
+ * on the header.
+ */
+static bool validHeader(const DataFileHeader & header) {
+	if (memcmp(header.magic, "DCNT", 4)) {
+		cerr << "Not a data container file" << endl;
+		return false;
+	}
+	if (header.byte_order != DataFileByteOrder) {
+		cerr << "Data container file is stored with another byte order" << endl;
+		return false;
+	}
+	if (header.version != DataFileVersion || (header.layout != DL_COLUMNS && header.layout != DL_BITS)) {
+		cerr << "Unknown version " << header.version << " or layout of data container file" << endl;
+		return false;
+	}
+	// so that the sizes of the arrays can be computed without overflow
+	if (header.count > (size_t)-1 / 16 || header.columns > INT_MAX) {
+		cerr << "Data container file has a corrupt header" << endl;
+		return false;
+	}
+	// a raster has to consist of whole columns, an item is found by dividing by the height
+	if (header.layout == DL_BITS && (header.height < 0 || (header.height == 0 ?
+			header.count || header.columns :
+			header.count % header.height || header.count / header.height != header.columns))) {
+		cerr << "Data container file has a raster of " << header.columns << " columns of "
+				<< header.height << " bits instead of " << header.count << " bits" << endl;
+		return false;
+	}
+	return true;
+}
+
+//! Read an array of the given number of bytes, nothing for an empty array
+template <typename T>
+static void readArray(std::istream & in, std::vector<T> & array, size_t bytes) {
+	if (bytes) in.read((char*)&array[0], bytes);
+}
+
+bool DataContainer::write(std::ostream& out) const {
+	DataFileHeader head;
+	header(head);
+	std::vector< std::pair<const void*,size_t> > parts;
+	std::vector<uint64_t> scratch;
+	segments(parts, scratch);
+	out.write((const char*)&head, sizeof(head));
+	for (size_t i = 0; i < parts.size(); ++i) {
+		out.write((const char*)parts[i].first, parts[i].second);
+	}
+	return out.good();
+}
+
+/**
+ * The header and the arrays are handed to the kernel at once with writev. The loop is only there
+ * for partial writes (e.g. to a full disk or a pipe).
+ */
+bool DataContainer::write(const std::string & file) const {
+	DataFileHeader head;
+	header(head);
+	std::vector< std::pair<const void*,size_t> > parts;
+	std::vector<uint64_t> scratch;
+	segments(parts, scratch);
+
+	std::vector<struct iovec> iov(parts.size() + 1);
+	iov[0].iov_base = &head;
+	iov[0].iov_len = sizeof(head);
+	for (size_t i = 0; i < parts.size(); ++i) {
+		iov[i+1].iov_base = const_cast<void*>(parts[i].first);
+		iov[i+1].iov_len = parts[i].second;
+	}
+
+	int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		cerr << "Could not open " << file << " for writing" << endl;
+		return false;
+	}
+	size_t first = 0;
+	while (first < iov.size()) {
+		int n = std::min(iov.size() - first, (size_t)IOV_MAX);
+		ssize_t written = writev(fd, &iov[first], n);
+		if (written < 0) {
+			cerr << "Could not write " << file << endl;
+			close(fd);
+			return false;
+		}
+		while (first < iov.size() && (size_t)written >= iov[first].iov_len) {
+			written -= iov[first].iov_len;
+			++first;
+		}
+		if (first < iov.size()) {
+			iov[first].iov_base = (char*)iov[first].iov_base + written;
+			iov[first].iov_len -= written;
+		}
+	}
+	return close(fd) == 0;
+}
+
+/**
+ * The arrays are only allocated if the stream is long enough for them, so a corrupt header does not
+ * lead to a huge allocation. Streams that can not seek (e.g. a pipe) are not checked.
+ */
+bool DataContainer::read(std::istream& in) {
+	DataFileHeader head;
+	if (!in.read((char*)&head, sizeof(head)) || !validHeader(head)) return false;
+	size_t sizes[3];
+	size_t total = arraySizes(head, sizes);
+	std::streampos start = in.tellg();
+	if (start != std::streampos(-1) && in.seekg(0, std::ios::end)) {
+		std::streampos end = in.tellg();
+		in.seekg(start);
+		if (end != std::streampos(-1) && (size_t)(end - start) < total) {
+			cerr << "Data container file is truncated" << endl;
+			return false;
+		}
+	}
+	in.clear();
+	assert (!window);
+	clear();
+	layout = (DataLayout)head.layout;
+	id = head.id;
+	data_height = head.height;
+	if (layout == DL_BITS) {
+		bits.resize(sizes[0] / sizeof(uint64_t));
+		column_x.resize(head.columns);
+		readArray(in, bits, sizes[0]);
+		readArray(in, column_x, sizes[1]);
+	} else {
+		values.resize(head.count);
+		coord_x.resize(head.count);
+		coord_y.resize(head.count);
+		readArray(in, values, sizes[0]);
+		readArray(in, coord_x, sizes[1]);
+		readArray(in, coord_y, sizes[2]);
+	}
+	count = head.count;
+	columns = head.columns;
+	sync();
+	if (!in) {
+		cerr << "Data container file is truncated" << endl;
+		clear();
+		return false;
+	}
+	return true;
+}
+
+bool DataContainer::map(const std::string & file) {
+	assert (!window);
+	clear();
+	int fd = open(file.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) || (size_t)st.st_size < sizeof(DataFileHeader)) {
+		close(fd);
+		return false;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+
+	const DataFileHeader & head = *(const DataFileHeader*)data;
+	size_t sizes[3];
+	if (!validHeader(head) || sizeof(head) + arraySizes(head, sizes) > (size_t)st.st_size) {
+		munmap(data, st.st_size);
+		return false;
+	}
+	mapping = data;
+	mapping_size = st.st_size;
+	layout = (DataLayout)head.layout;
+	id = head.id;
+	data_height = head.height;
+	count = head.count;
+	columns = head.columns;
+
+	const char *array = (const char*)data + sizeof(head);
+	if (layout == DL_BITS) {
+		bit_data = (const uint64_t*)array;
+		column_x_data = (const int*)(array + sizes[0]);
+	} else {
+		value_data = (const DC_TYPE*)array;
+		x_data = (const int*)(array + sizes[0]);
+		y_data = (const int*)(array + sizes[0] + sizes[1]);
+	}
+	return true;
 }
 //
 //template<>
@@ -159,85 +551,6 @@ void DataContainer::clear() {
 //	return *it;
 //}
 
-/**
- * Local class that knows that colons can be treated as white spaces. It is
- * used by read.
- */
-struct colonsep: std::ctype<char> {
-	colonsep(): std::ctype<char>(get_table()) {}
-
-	static std::ctype_base::mask const* get_table() {
-		static std::vector<std::ctype_base::mask>
-		rc(std::ctype<char>::table_size,std::ctype_base::mask());
-
-		rc[':'] = std::ctype_base::space;
-		rc[' '] = std::ctype_base::space;
-		rc['\n'] = std::ctype_base::space;
-		return &rc[0];
-	}
-};
-
-/**
- * Read data from a file. Only DT_MAP is tested. With an array it is hard to set the
- * size beforehand properly (except if you know what to retrieve).
- */
-//void DataContainer::read(std::istream& in) { //, DataDecoratorType resolution) {
-//	DataDecoratorType x;
-//	switch(dataType) {
-//	case DT_MAP:
-//		assert (map_data != NULL);
-//		map_data->clear();
-//		int y;
-//		in.imbue(std::locale(std::locale(), new colonsep));
-//
-//		while(in >> x >> y) {
-//			map_data->insert(make_pair<DataDecoratorType,int>(x, y));
-//			assert(y != 0);
-//		}
-//		break;
-//	case DT_F2DARRAY:
-//		assert (float_data != NULL);
-//		int ix;
-//		float fy;
-//		in.imbue(std::locale(std::locale(), new colonsep));
-//		while(in >> ix >> fy) {
-//			if (ix >= float_data_len) {
-//				cerr << "Array is not large enough (" << float_data_len << ")" << endl;
-//				break;
-//			}
-//			float_data[ix] = fy;
-//			cout << "x and y: " << ix << " and " << fy << endl;
-//		}
-//		break;
-//
-//	default:
-//		cerr << "Read: Unknown data type" << endl;
-//		break;
-//	}
-//}
-
-/**
- * Write map_data to a file
- */
-//void DataContainer::write(std::ostream& out) {
-//	std::map<DataDecoratorType,int>::const_iterator i;
-//	out << fixed << setprecision (10);
-//	switch(dataType) {
-//	case DT_MAP:
-//		assert (map_data != NULL);
-//		for (i = map_data->begin(); i != map_data->end(); ++i) {
-//			out << i->first << ": " << i->second << "\n";
-//		}
-//		break;
-//	case DT_F2DARRAY:
-////		cerr << "We don't know how to write this" << endl;
-//		break;
-//	default:
-//		cerr << "Write: Unknown data type" << endl;
-//		break;
-//	}
-//}
-
 //void DataContainer::clear() {
 //	switch(dataType) {
 //	case DT_MAP:
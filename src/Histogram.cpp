@@ -0,0 +1,145 @@
+/**
+ * @file Histogram.cpp
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+// General files
+#include <Histogram.h>
+#include <math.h>
+#include <assert.h>
+
+using namespace std;
+
+/* **************************************************************************************
+ * Implementation of Histogram
+ * **************************************************************************************/
+
+Histogram::Histogram(HistogramScale scale, double min, double max, int bins):
+		scale(scale), min(min), max(max), min_exponent(0), total(0), underflow(0), overflow(0) {
+	assert (max > min && bins > 0);
+	switch (scale) {
+	case HS_LINEAR:
+		step = (max - min) / bins;
+		counts.resize(bins, 0);
+		break;
+	case HS_LOG:
+		assert (min > 0);
+		step = log(max / min) / bins;
+		counts.resize(bins, 0);
+		break;
+	case HS_HDR: {
+		assert (min > 0 && !(bins & (bins - 1)));
+		int max_exponent;
+		frexp(min, &min_exponent);
+		frexp(max, &max_exponent);
+		step = bins;
+		counts.resize((max_exponent - min_exponent + 1) * bins, 0);
+		break;
+	}
+	default:
+		assert (false);
+	}
+}
+
+/**
+ * For HS_HDR the value is split in its mantissa f in [0.5, 1) and exponent e, which selects the
+ * power of two. The mantissa selects the linear bin within it.
+ */
+int Histogram::index(double value) const {
+	switch (scale) {
+	case HS_LINEAR:
+		return (int)((value - min) / step);
+	case HS_LOG:
+		return (int)(log(value / min) / step);
+	case HS_HDR: {
+		int e;
+		double f = frexp(value, &e);
+		int per_octave = (int)step;
+		return (e - min_exponent) * per_octave + (int)((f - 0.5) * 2 * per_octave);
+	}
+	default:
+		return 0;
+	}
+}
+
+double Histogram::lower(int i) const {
+	switch (scale) {
+	case HS_LINEAR:
+		return min + i * step;
+	case HS_LOG:
+		return min * exp(i * step);
+	case HS_HDR: {
+		// the first power of two starts below the minimum and the last one ends above the
+		// maximum, the bins outside the range stay empty and get no width
+		int per_octave = (int)step;
+		double edge = ldexp(0.5 + (i % per_octave) / (2.0 * per_octave),
+				min_exponent + i / per_octave);
+		return (edge < min) ? min : (edge > max) ? max : edge;
+	}
+	default:
+		return 0;
+	}
+}
+
+void Histogram::merge(const Histogram & other) {
+	assert (other.scale == scale && other.counts.size() == counts.size());
+	for (size_t i = 0; i < counts.size(); ++i) {
+		counts[i] += other.counts[i];
+	}
+	total += other.total;
+	underflow += other.underflow;
+	overflow += other.overflow;
+}
+
+void Histogram::clear() {
+	counts.assign(counts.size(), 0);
+	total = underflow = overflow = 0;
+}
+
+/**
+ * Walk over the cumulative counts until the bin is found that contains the quantile. Within the
+ * bin the values are assumed to be uniformly distributed, on a log scale for HS_LOG.
+ */
+double Histogram::quantile(double q) const {
+	if (total == 0) return 0;
+	double target = q * total;
+	double sum = underflow;
+	if (target <= sum) return min;
+	for (size_t i = 0; i < counts.size(); ++i) {
+		if (counts[i] == 0) continue;
+		if (sum + counts[i] >= target) {
+			double fraction = (target - sum) / counts[i];
+			double lo = lower(i), hi = upper(i);
+			if (scale == HS_LOG) return lo * pow(hi / lo, fraction);
+			return lo + (hi - lo) * fraction;
+		}
+		sum += counts[i];
+	}
+	return max;
+}
+
+void Histogram::getBins(std::map<double,long> & result) const {
+	result.clear();
+	for (size_t i = 0; i < counts.size(); ++i) {
+		if (counts[i]) result[lower(i)] = counts[i];
+	}
+}
@@ -0,0 +1,122 @@
+/***************************************************************************************************
+ * @brief
+ * @file InputBuffer.cpp
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+#include <InputBuffer.h>
+
+#include <assert.h>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+InputBuffer::InputBuffer(int horizon) {
+	int size = 1;
+	while (size < horizon) size <<= 1;
+	ring.resize(size);
+	now = 0;
+}
+
+/**
+ * The ring covers the ticks (now, now + size). Ticks in the past are not scheduled, so they do
+ * not need to be reached. To reach further, a ring of the next power of two
+ * that is large enough is created and the scheduled spikes are moved into it. The slots keep
+ * their memory, so this is cheap and happens only a few times.
+ */
+void InputBuffer::reach(int tick) {
+	if (tick <= now) return;
+	size_t size = ring.size();
+	if ((size_t)(tick - now) < size) return;
+	while ((size_t)(tick - now) >= size) size <<= 1;
+
+	std::vector< std::vector<int> > grown(size);
+	for (size_t d = 1; d < ring.size(); ++d) {
+		grown[(now + d) & (size - 1)].swap(slot(now + d));
+	}
+	ring.swap(grown);
+}
+
+void InputBuffer::addSpike(int tick, int neuron) {
+	if (tick <= now) {
+		cerr << "Spike at tick " << tick << " is in the past, we are at " << now << endl;
+		return;
+	}
+	reach(tick);
+	slot(tick).push_back(neuron);
+}
+
+void InputBuffer::addSpikes(const int *ticks, const int *neurons, size_t count) {
+	if (!count) return;
+	reach(*max_element(ticks, ticks + count));
+	for (size_t i = 0; i < count; ++i) {
+		if (ticks[i] <= now) {
+			cerr << "Spike at tick " << ticks[i] << " is in the past, we are at " << now << endl;
+			continue;
+		}
+		slot(ticks[i]).push_back(neurons[i]);
+	}
+}
+
+void InputBuffer::addSpikeTrain(int neuron, const int *ticks, size_t count) {
+	if (!count) return;
+	reach(*max_element(ticks, ticks + count));
+	for (size_t i = 0; i < count; ++i) {
+		if (ticks[i] <= now) {
+			cerr << "Spike at tick " << ticks[i] << " is in the past, we are at " << now << endl;
+			continue;
+		}
+		slot(ticks[i]).push_back(neuron);
+	}
+}
+
+void InputBuffer::addCurrents(const NN_VALUE *frames, int first, int ticks, int stride) {
+	assert (blocks.empty() || blocks.back().first + blocks.back().ticks <= first);
+	CurrentBlock block;
+	block.frames = frames;
+	block.first = first;
+	block.ticks = ticks;
+	block.stride = stride;
+	blocks.push_back(block);
+}
+
+/**
+ * The slot of the previous tick (and of ticks that have been skipped) is cleared, after which it
+ * can be reused for the tick at the other end of the ring.
+ */
+const std::vector<int> & InputBuffer::spikes(int tick) {
+	while (now < tick) {
+		slot(now).clear();
+		++now;
+	}
+	std::vector<int> & spikes = slot(tick);
+	std::sort(spikes.begin(), spikes.end());
+	spikes.erase(std::unique(spikes.begin(), spikes.end()), spikes.end());
+	return spikes;
+}
+
+const NN_VALUE *InputBuffer::currents(int tick) {
+	while (!blocks.empty() && blocks.front().first + blocks.front().ticks <= tick) {
+		blocks.pop_front();
+	}
+	if (blocks.empty() || blocks.front().first > tick) return NULL;
+	CurrentBlock & block = blocks.front();
+	return block.frames + (size_t)(tick - block.first) * block.stride;
+}
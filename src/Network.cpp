@@ -28,9 +28,30 @@
 #include <math.h>
 #include <time.h>
 #include <iostream>
+#include <algorithm>
+#include <new>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
+//! Reversal potentials of the receptors and the resting potential (mV), conductances are scaled
+//! so that they give the same current at rest as SD_CURRENT does, with the sign of E - v
+const NN_VALUE ReversalPotential[SR_COUNT] = { 0, -70 };
+const NN_VALUE RestingPotential = -65;
+
+//! Number of tasks per thread the spikes are divided in, so that threads that are done early can
+//! take over the tasks of the others
+const int TasksPerThread = 8;
+
 /**
  * The STDP rule described in Izhikevich article "Polychronization: Computation with Spikes"
  * is implemented by using an array with the exponential values for all t precalculated (the
@@ -41,29 +62,233 @@ using namespace std;
  *
  * The first item is when there is an interval of 0. So, that value is conflicting in both
  * sequences. When spikes are really at the same time, no weight change occurs.
- * @remark A float (6 significant decimals) is used.
+ * @remark The values are computed as the original in-place expressions were, so the weights do
+ * not change by using the table. The table has an entry for every tick up to the maximum delay,
+ * see Network::setMaxDelay().
+ */
+//! The time constant of STDP in ticks, also for longer maximum delays
+const int StdpTau = 20;
+
+//! The number of words of a history, Words if it is known at compile time (not 0)
+template <int Words>
+static inline int wordCount(int words) {
+	return Words ? Words : words;
+}
+
+template <int Words>
+static inline bool raisedAt(ConnNeuron *cn, int delay) {
+	if (Words == 1) return (cn->history >> delay) & 1;
+	return cn->raised(delay);
+}
+
+//! The most recent spike at least delay ticks ago, -1 if there is none
+template <int Words>
+static inline int firstAt(ConnNeuron *cn, int delay, int words) {
+	if (Words == 1) {
+		HISTORY h = cn->history >> delay;
+		return h ? delay + __builtin_ctzll(h) : -1;
+	}
+	int w = delay / HISTORY_BITS;
+	HISTORY h = cn->word(w) >> (delay % HISTORY_BITS);
+	if (h) return delay + __builtin_ctzll(h);
+	for (++w; w < wordCount<Words>(words); ++w) {
+		h = cn->older[w - 1];
+		if (h) return w * HISTORY_BITS + __builtin_ctzll(h);
+	}
+	return -1;
+}
+
+//! If a neuron fired within the history
+template <int Words>
+static inline bool isActive(ConnNeuron *cn, int words) {
+	if (cn->history) return true;
+	for (int w = 1; w < wordCount<Words>(words); ++w) {
+		if (cn->older[w - 1]) return true;
+	}
+	return false;
+}
+
+//! Shift the history by a tick, the bit that falls out of a word moves into the next one
+template <int Words>
+static inline void advanceHistory(ConnNeuron *cn, int words, HISTORY mask) {
+	int count = wordCount<Words>(words);
+	HISTORY carry = cn->history >> (HISTORY_BITS - 1);
+	cn->history <<= 1;
+	for (int w = 1; w < count; ++w) {
+		HISTORY next = cn->older[w - 1] >> (HISTORY_BITS - 1);
+		cn->older[w - 1] = (cn->older[w - 1] << 1) | carry;
+		carry = next;
+	}
+	cn->word(count - 1) &= mask;
+}
+
+static bool isPruned(const Synapse *synapse) {
+	return synapse->pruned;
+}
+
+//! Synapses by the new position of their post-synaptic neuron
+struct PostOrder {
+	PostOrder(const std::vector<int> & position): position(position) {}
+	bool operator()(const Synapse *a, const Synapse *b) const {
+		return position[a->post->id] < position[b->post->id];
+	}
+	const std::vector<int> & position;
+};
+
+//! Neuron ids by increasing degree
+struct DegreeOrder {
+	DegreeOrder(const std::vector<long> & degree): degree(degree) {}
+	bool operator()(int a, int b) const { return degree[a] < degree[b]; }
+	const std::vector<long> & degree;
+};
+
+/**
+ * The NUMA node of every CPU, from the CPU lists of the nodes in sysfs. Without them, all CPUs
+ * are on node 0.
  */
-//const float LTD[16] = {-0.120000, -0.114148, -0.108580, -0.103285, -0.098248, -0.093456, -0.088898, -0.084563,
-//		-0.080438, -0.076515, -0.072784, -0.069234, -0.065857, -0.062645, -0.059590, -0.056684};
+static void getCpuNodes(std::vector<int> & node_of) {
+	node_of.clear();
+	for (int node = 0; node < PLACEMENT_NODES; ++node) {
+		std::ostringstream path;
+		path << "/sys/devices/system/node/node" << node << "/cpulist";
+		std::ifstream in(path.str().c_str());
+		int from, to;
+		char separator;
+		// ranges such as "0-3,8-11"
+		while (in >> from) {
+			to = from;
+			if (in.peek() == '-') in >> separator >> to;
+			if ((int)node_of.size() <= to) node_of.resize(to + 1, 0);
+			for (int cpu = from; cpu <= to; ++cpu) node_of[cpu] = node;
+			if (in.peek() != ',') break;
+			in >> separator;
+		}
+	}
+}
+
 /**
- * @see LTP
+ * Count the pages of a block of memory per NUMA node. The kernel is asked with move_pages
+ * without target nodes, which only reports where the pages are.
  */
-//const float LTP[16] = {0.100000, 0.095123, 0.090484, 0.086071, 0.081873, 0.077880, 0.074082, 0.070469,
-//		0.067032, 0.063763, 0.060653, 0.057695, 0.054881, 0.052205, 0.049659, 0.047237};
+static void countPages(const void *start, size_t bytes, long *pages, long & unknown) {
+	if (start == NULL || !bytes) return;
+	uintptr_t page = sysconf(_SC_PAGESIZE);
+	uintptr_t end = (uintptr_t)start + bytes;
+	std::vector<void*> addresses;
+	for (uintptr_t a = (uintptr_t)start & ~(page - 1); a < end; a += page) {
+		addresses.push_back((void*)a);
+	}
+	std::vector<int> status(addresses.size(), -1);
+#ifdef __linux__
+	if (syscall(SYS_move_pages, 0, addresses.size(), &addresses[0], NULL, &status[0], 0))
+		status.assign(addresses.size(), -1);
+#endif
+	for (size_t i = 0; i < status.size(); ++i) {
+		if (status[i] >= 0 && status[i] < PLACEMENT_NODES) ++pages[status[i]];
+		else ++unknown;
+	}
+}
 
 Network::Network() {
-	srand48(time(NULL));
+	init(time(NULL));
+}
+
+Network::Network(long seed) {
+	init(seed);
+}
+
+void Network::init(long seed) {
+	this->seed(seed);
 	t = 0;
+	delivery = DM_AUTO;
+	last_delivery = DM_SCAN;
+	incoming_stale = true;
+	parallel_grain = 16384;
+	setSynapticDynamics(SD_INSTANT);
+	inhibition = false;
+	history_words = 1;
+	setMaxDelay(HISTORY_SIZE);
+	input = NULL;
+	stats_interval = 0;
+	stats_out = &std::cout;
+	setPruning(0);
+	pruned_count = pruned_pending = 0;
+	generation = 0;
+	merge_threshold = 0;
+	input_count = 0;
+	synapse_block = NULL;
+	synapse_block_size = 0;
+	conn_block = NULL;
+	neuron_block = NULL;
+	block_size = 0;
+}
+
+/**
+ * The generator is the same as that of drand48, but its state is kept per network. This makes it
+ * possible to run two networks side by side from the same seed, see Equivalence.hpp. The state
+ * is initialized in the same way as srand48 does, so seed(s) followed by uniform() gives the same
+ * sequence as srand48(s) followed by drand48().
+ */
+void Network::seed(long seed) {
+	rng[0] = 0x330E;
+	rng[1] = seed & 0xFFFF;
+	rng[2] = (seed >> 16) & 0xFFFF;
+}
+
+/**
+ * The network owns its neurons and synapses, so they are deleted with it.
+ */
+Network::~Network() {
+	merge();
+	SYNAPSES::iterator s_it;
+	for (s_it = synapses.begin(); s_it != synapses.end(); ++s_it) {
+		if (!inBlock(*s_it)) delete *s_it;
+	}
+	releaseSynapseBlock();
+	NEURONS::iterator n_it;
+	for (n_it = neurons.begin(); n_it != neurons.end(); ++n_it) {
+		delete (*n_it)->outgoing;
+		delete [] (*n_it)->older;
+		if (inBlock(*n_it)) continue;
+		delete (*n_it)->neuron;
+		delete *n_it;
+	}
+	releaseBlock();
+}
+
+void Network::releaseSynapseBlock() {
+	::operator delete(synapse_block);
+	synapse_block = NULL;
+	synapse_block_size = 0;
+}
+
+void Network::releaseBlock() {
+	for (size_t i = 0; i < block_size; ++i) {
+		conn_block[i].~ConnNeuron();
+		neuron_block[i].~Neuron();
+	}
+	::operator delete(conn_block);
+	::operator delete(neuron_block);
+	conn_block = NULL;
+	neuron_block = NULL;
+	block_size = 0;
 }
 
 /**
  * Add a new neuron to the network
  */
-void Network::addNeuron(NeuronType type, NeuronSign sign, NeuronLocation loc) {
-	ConnNeuron *cn = new ConnNeuron(neurons.size());
+ConnNeuron *Network::addNeuron(NeuronType type, NeuronSign sign, NeuronLocation loc) {
+	ConnNeuron *cn = new ConnNeuron(neurons.size() + added_neurons.size());
 	cn->neuron = new Neuron(type, sign, loc);
 	cn->outgoing = NULL;
-	neurons.push_back(cn);
+	if (history_words > 1) cn->older = new HISTORY[history_words - 1]();
+	if (t) added_neurons.push_back(cn);
+	else neurons.push_back(cn);
+	if (!position.empty()) {
+		position.push_back(cn->id);
+		input_slots.push_back(loc == NL_INPUT ? input_count++ : -1);
+	}
+	return cn;
 }
 
 /**
@@ -78,19 +303,265 @@ void Network::addSynapse(ConnNeuron *src, ConnNeuron *target) {
 	src->outgoing->push_back(synapse);
 	if (src->neuron->getSign() == NS_EXCITATORY) {
 		synapse->weight = 6.0;
-		synapse->delay = (int)(drand48()*HISTORY_SIZE);
+		synapse->delay = (int)(uniform()*max_delay);
 	}
 	else if (src->neuron->getSign() == NS_INHIBITORY) {
 		synapse->weight = -5.0;
 		synapse->delay = 1;
 	}
-	synapses.push_back(synapse);
+	if (prune_ticks && src->neuron->getSign() != NS_INHIBITORY && synapse->weight <= prune_floor)
+		synapse->floor_since = t;
+	if (t) added_synapses.push_back(synapse);
+	else synapses.push_back(synapse);
+	if (!t) incoming_stale = true;
+	else if (!incoming_stale && src->neuron->getSign() != NS_INHIBITORY) addIncoming(synapse);
+}
+
+/**
+ * A scan visits the incoming synapses of a neuron by the position of their pre-synaptic neuron,
+ * and a synapse that is added comes after the other outgoing synapses of its pre-synaptic neuron.
+ * So it is inserted after the added synapses of pre-synaptic neurons at the same or a lower
+ * position, which is mostly at the end. The lists are merged with the others in updateIncoming().
+ */
+void Network::addIncoming(Synapse *synapse) {
+	int k = getPosition(synapse->post->id);
+	if ((int)incoming_added.size() <= k) incoming_added.resize(getNeuronCount());
+	SYNAPSES & added = incoming_added[k];
+	int pre = getPosition(synapse->pre->id);
+	SYNAPSES::iterator it = added.end();
+	while (it != added.begin() && getPosition((*(it - 1))->pre->id) > pre) --it;
+	added.insert(it, synapse);
+}
+
+/**
+ * The neurons and synapses that are added while running are only appended to the main lists
+ * when there are enough of them, so these lists grow in a few large steps. They are visited
+ * after the main lists, which is the order they have after the merge, so the dynamics do not
+ * depend on when it happens. The lists of incoming synapses are rebuilt with the added synapses
+ * in them at the next pull, so that costs O(1) per added synapse as well. That is why accessors
+ * such as getWeights() visit both lists instead of merging.
+ */
+void Network::merge() {
+	if (!added_neurons.empty()) {
+		neurons.insert(neurons.end(), added_neurons.begin(), added_neurons.end());
+		added_neurons.clear();
+		incoming_stale = true;
+	}
+	if (!added_synapses.empty()) {
+		synapses.insert(synapses.end(), added_synapses.begin(), added_synapses.end());
+		added_synapses.clear();
+		incoming_stale = true;
+	}
+}
+
+/**
+ * Reverse Cuthill-McKee: a breadth-first search over the (undirected) synapse graph, starting at
+ * a neuron of the lowest degree and visiting the neighbours in order of increasing degree. The
+ * neighbours of a neuron then get positions close to each other, and close to the neuron itself.
+ */
+void Network::reorder() {
+	merge();
+	int n = neurons.size();
+	if (!n) return;
+
+	// adjacency lists of all neurons in one array, by id
+	std::vector<long> offset(n + 1, 0);
+	SYNAPSES::iterator s_it;
+	for (s_it = synapses.begin(); s_it != synapses.end(); ++s_it) {
+		++offset[(*s_it)->pre->id + 1];
+		++offset[(*s_it)->post->id + 1];
+	}
+	for (int i = 0; i < n; ++i) offset[i + 1] += offset[i];
+	std::vector<int> adjacent(offset[n]);
+	std::vector<long> fill(offset.begin(), offset.end() - 1);
+	for (s_it = synapses.begin(); s_it != synapses.end(); ++s_it) {
+		adjacent[fill[(*s_it)->pre->id]++] = (*s_it)->post->id;
+		adjacent[fill[(*s_it)->post->id]++] = (*s_it)->pre->id;
+	}
+	std::vector<long> degree(n);
+	for (int i = 0; i < n; ++i) degree[i] = offset[i + 1] - offset[i];
+	DegreeOrder by_degree(degree);
+
+	std::vector<int> starts(n);
+	for (int i = 0; i < n; ++i) starts[i] = i;
+	std::stable_sort(starts.begin(), starts.end(), by_degree);
+
+	std::vector<int> order;
+	order.reserve(n);
+	std::vector<bool> visited(n, false);
+	std::vector<int> next;
+	for (int i = 0; i < n; ++i) {
+		if (visited[starts[i]]) continue;
+		visited[starts[i]] = true;
+		size_t head = order.size();
+		order.push_back(starts[i]);
+		while (head < order.size()) {
+			int id = order[head++];
+			next.clear();
+			for (long a = offset[id]; a < offset[id + 1]; ++a) {
+				if (visited[adjacent[a]]) continue;
+				visited[adjacent[a]] = true;
+				next.push_back(adjacent[a]);
+			}
+			std::stable_sort(next.begin(), next.end(), by_degree);
+			order.insert(order.end(), next.begin(), next.end());
+		}
+	}
+	std::reverse(order.begin(), order.end());
+
+	relocate(order, true);
+	position.assign(n, 0);
+	for (int k = 0; k < n; ++k) position[order[k]] = k;
+
+	// the input neurons keep their index in the current frames
+	input_slots.assign(n, -1);
+	input_count = 0;
+	for (int id = 0; id < n; ++id) {
+		if (neurons[position[id]]->neuron->getLoc() == NL_INPUT) input_slots[id] = input_count++;
+	}
+}
+
+void Network::place() {
+	merge();
+	std::vector<int> order(neurons.size());
+	for (size_t k = 0; k < neurons.size(); ++k) order[k] = neurons[k]->id;
+	relocate(order, false);
+}
+
+/**
+ * Every OpenMP thread constructs the neurons of its (static) part of the order, with their
+ * outgoing synapses and the lists that refer to these. A page of memory is placed on the NUMA
+ * node of the thread that touches it first, so this divides the network over the nodes in the
+ * same way as the threads are, see pinThreads(). The synapses end up grouped by pre-synaptic
+ * neuron, in the order of delivery, and the global list gets this order as well.
+ */
+void Network::relocate(const std::vector<int> & order, bool sort) {
+	int n = order.size();
+	NEURONS by_id(n);
+	NEURONS::iterator n_it;
+	for (n_it = neurons.begin(); n_it != neurons.end(); ++n_it) {
+		by_id[(*n_it)->id] = *n_it;
+	}
+	std::vector<int> moved(n);
+	std::vector<size_t> first(n + 1, 0);
+	for (int k = 0; k < n; ++k) {
+		ConnNeuron *old = by_id[order[k]];
+		moved[order[k]] = k;
+		first[k + 1] = first[k] + (old->outgoing != NULL ? old->outgoing->size() : 0);
+	}
+	size_t count = first[n];
+	assert (count == synapses.size());
+
+	ConnNeuron *conns = static_cast<ConnNeuron*>(::operator new(n * sizeof(ConnNeuron)));
+	Neuron *cells = static_cast<Neuron*>(::operator new(n * sizeof(Neuron)));
+	Synapse *block = static_cast<Synapse*>(::operator new(count * sizeof(Synapse)));
+	NEURONS relocated(n);
+	PostOrder by_post(moved);
+	#pragma omp parallel for schedule(static)
+	for (int k = 0; k < n; ++k) {
+		ConnNeuron *old = by_id[order[k]];
+		new (&cells[k]) Neuron(*old->neuron);
+		new (&conns[k]) ConnNeuron(*old);
+		conns[k].neuron = &cells[k];
+		relocated[k] = &conns[k];
+		if (old->outgoing == NULL) continue;
+		SYNAPSES *outgoing = new SYNAPSES(*old->outgoing);
+		if (sort) std::stable_sort(outgoing->begin(), outgoing->end(), by_post);
+		for (size_t j = 0; j < outgoing->size(); ++j) {
+			Synapse *synapse = new (&block[first[k] + j]) Synapse(*(*outgoing)[j]);
+			synapse->pre = &conns[k];
+			synapse->post = &conns[moved[synapse->post->id]];
+			(*outgoing)[j] = synapse;
+		}
+		conns[k].outgoing = outgoing;
+	}
+
+	SYNAPSES::iterator s_it;
+	for (s_it = synapses.begin(); s_it != synapses.end(); ++s_it) {
+		if (!inBlock(*s_it)) delete *s_it;
+	}
+	for (size_t i = 0; i < count; ++i) synapses[i] = &block[i];
+	releaseSynapseBlock();
+	synapse_block = block;
+	synapse_block_size = count;
+
+	for (n_it = neurons.begin(); n_it != neurons.end(); ++n_it) {
+		delete (*n_it)->outgoing;
+		if (inBlock(*n_it)) continue;
+		delete (*n_it)->neuron;
+		delete *n_it;
+	}
+	releaseBlock();
+	conn_block = conns;
+	neuron_block = cells;
+	block_size = n;
+	neurons.swap(relocated);
+	incoming_stale = true;
+	++generation;
+}
+
+/**
+ * The allowed CPUs are sorted by node and divided evenly over the threads. With the static parts
+ * of relocate(), thread i then places the i-th part of the network on the node it runs on.
+ */
+void Network::pinThreads() {
+#ifdef __linux__
+	cpu_set_t allowed;
+	if (sched_getaffinity(0, sizeof(allowed), &allowed)) return;
+	std::vector<int> node_of;
+	getCpuNodes(node_of);
+	std::vector< std::pair<int,int> > cpus;
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (!CPU_ISSET(cpu, &allowed)) continue;
+		cpus.push_back(std::make_pair(cpu < (int)node_of.size() ? node_of[cpu] : 0, cpu));
+	}
+	std::sort(cpus.begin(), cpus.end());
+	int threads = 1;
+#ifdef _OPENMP
+	threads = omp_get_max_threads();
+#endif
+	thread_cpus.assign(threads, -1);
+	#pragma omp parallel num_threads(threads)
+	{
+		int i = 0;
+#ifdef _OPENMP
+		i = omp_get_thread_num();
+#endif
+		int cpu = cpus[(size_t)i * cpus.size() / threads].second;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		if (!sched_setaffinity(0, sizeof(set), &set)) thread_cpus[i] = cpu;
+	}
+#endif
+}
+
+void Network::getPlacement(NetworkPlacement & placement) {
+	placement.clear();
+	countPages(conn_block, block_size * sizeof(ConnNeuron), placement.neuron_pages,
+			placement.unknown_pages);
+	countPages(neuron_block, block_size * sizeof(Neuron), placement.neuron_pages,
+			placement.unknown_pages);
+	countPages(synapse_block, synapse_block_size * sizeof(Synapse), placement.synapse_pages,
+			placement.unknown_pages);
+	std::vector<int> node_of;
+	getCpuNodes(node_of);
+	for (size_t i = 0; i < thread_cpus.size(); ++i) {
+		int cpu = thread_cpus[i];
+		placement.cpus.push_back(cpu);
+		placement.nodes.push_back(cpu >= 0 && cpu < (int)node_of.size() ? node_of[cpu] : -1);
+	}
+}
+
+void Network::setMergeThreshold(size_t items) {
+	merge_threshold = items;
 }
 
 /**
  * Add outgoing synapses
  */
 void Network::addSynapses(ConnNeuron *src, float fraction) {
+	merge();
 	NEURONS *nn;
 	if (fraction == 1.0) {
 		nn = &neurons;
@@ -109,85 +580,628 @@ void Network::addSynapses(ConnNeuron *src, float fraction) {
 }
 
 void Network::getNeurons(std::vector<ConnNeuron*> &subset, float fraction) {
-	NEURONS::iterator it;
 	subset.clear();
-	for (it = neurons.begin(); it != neurons.end(); ++it) {
-		if (drand48() < fraction) {
-			subset.push_back(*it);
+	NEURONS *lists[] = { &neurons, &added_neurons };
+	for (int l = 0; l < 2; ++l) {
+		NEURONS::iterator it;
+		for (it = lists[l]->begin(); it != lists[l]->end(); ++it) {
+			if (uniform() < fraction) {
+				subset.push_back(*it);
+			}
 		}
 	}
 }
 
 void Network::addSynapses(float fraction) {
+	merge();
 	NEURONS::iterator it;
 	for (it = neurons.begin(); it != neurons.end(); ++it) {
 		addSynapses(*it, fraction);
 	}
 }
 
+/**
+ * Every synapse is a separate object on the heap and is referred to twice: from the global list
+ * of synapses and from the list of outgoing synapses of its pre-synaptic neuron, and once more
+ * from the list of incoming synapses if that has been built. Allocator overhead is not included.
+ */
+size_t Network::getSynapseMemory() {
+	size_t bytes = getSynapseCount() * sizeof(Synapse) + synapses.capacity() * sizeof(Synapse*)
+			+ added_synapses.capacity() * sizeof(Synapse*);
+	NEURONS *lists[] = { &neurons, &added_neurons };
+	for (int l = 0; l < 2; ++l) {
+		NEURONS::iterator it;
+		for (it = lists[l]->begin(); it != lists[l]->end(); ++it) {
+			if ((*it)->outgoing != NULL)
+				bytes += sizeof(SYNAPSES) + (*it)->outgoing->capacity() * sizeof(Synapse*);
+		}
+	}
+	return bytes;
+}
+
+void Network::getWeights(std::vector<NN_VALUE> & weights) {
+	weights.clear();
+	weights.reserve(getSynapseCount());
+	SYNAPSES *lists[] = { &synapses, &added_synapses };
+	for (int l = 0; l < 2; ++l) {
+		SYNAPSES::iterator it;
+		for (it = lists[l]->begin(); it != lists[l]->end(); ++it) {
+			weights.push_back((*it)->weight);
+		}
+	}
+}
+
+/**
+ * The histories of the neurons that already exist keep their spikes as far as they fit.
+ */
+void Network::setMaxDelay(int ticks) {
+	assert (ticks > 0);
+	merge();
+	SYNAPSES::iterator s_it;
+	for (s_it = synapses.begin(); s_it != synapses.end(); ++s_it) {
+		assert ((*s_it)->delay < ticks);
+	}
+	int words = (ticks + HISTORY_BITS - 1) / HISTORY_BITS;
+	int bits = ticks - (words - 1) * HISTORY_BITS;
+	HISTORY mask = (bits == HISTORY_BITS) ? ~HISTORY(0) : (HISTORY(1) << bits) - 1;
+	NEURONS::iterator it;
+	for (it = neurons.begin(); it != neurons.end(); ++it) {
+		ConnNeuron *cn = *it;
+		HISTORY *older = (words > 1) ? new HISTORY[words - 1]() : NULL;
+		for (int w = 1; w < std::min(words, history_words); ++w) older[w - 1] = cn->older[w - 1];
+		delete [] cn->older;
+		cn->older = older;
+		cn->word(words - 1) &= mask;
+	}
+	max_delay = ticks;
+	history_words = words;
+	history_mask = mask;
+
+	stdp_ltd.resize(ticks);
+	stdp_ltp.resize(ticks);
+	for (int first_spike = 0; first_spike < ticks; ++first_spike) {
+		stdp_ltd[first_spike] = 0.12 * exp(+first_spike/(NN_VALUE)StdpTau);
+		stdp_ltp[first_spike] = 0.10 * exp(-first_spike/(NN_VALUE)StdpTau);
+	}
+}
+
+/**
+ * With a decay d per tick, a spike that adds w to the state gives a drive (1 - d) w d^k in the
+ * k-th tick after, which sums to w.
+ */
+void Network::setSynapticDynamics(SynapticDynamics dynamics, NN_VALUE tau_ampa, NN_VALUE tau_gaba) {
+	assert (tau_ampa > 0 && tau_gaba > 0);
+	this->dynamics = dynamics;
+	receptor_decay[SR_AMPA] = exp(-1 / tau_ampa);
+	receptor_decay[SR_GABA] = exp(-1 / tau_gaba);
+}
+
+/**
+ * The synapses that are at the floor already are counted from the current tick, as if their
+ * weight had dropped to the floor in it. So they are pruned at the same tick whether they are
+ * visited or not, see sweep().
+ */
+void Network::setPruning(int ticks, NN_VALUE floor, int interval) {
+	prune_ticks = ticks;
+	prune_floor = floor;
+	compact_interval = interval;
+	if (!prune_ticks) return;
+	SYNAPSES *lists[] = { &synapses, &added_synapses };
+	for (int l = 0; l < 2; ++l) {
+		SYNAPSES::iterator it;
+		for (it = lists[l]->begin(); it != lists[l]->end(); ++it) {
+			Synapse *synapse = *it;
+			if (synapse->pruned || synapse->pre->neuron->getSign() == NS_INHIBITORY) continue;
+			if (synapse->weight > prune_floor) synapse->floor_since = -1;
+			else if (synapse->floor_since < 0) synapse->floor_since = t;
+		}
+	}
+}
+
+/**
+ * A synapse of which the weight does not change is not visited by a push or a pull, so it is
+ * only marked as pruned here, before it would be removed. Until then it is skipped when it is
+ * visited, see updateSynapse().
+ */
+void Network::sweep() {
+	if (!prune_ticks) return;
+	SYNAPSES *lists[] = { &synapses, &added_synapses };
+	for (int l = 0; l < 2; ++l) {
+		SYNAPSES::iterator it;
+		for (it = lists[l]->begin(); it != lists[l]->end(); ++it) {
+			Synapse *synapse = *it;
+			if (synapse->pruned || !expired(synapse, t)) continue;
+			synapse->pruned = true;
+			++pruned_count;
+			++pruned_pending;
+		}
+	}
+}
+
+/**
+ * The synapses that remain keep their order, in the global list as well as in the outgoing lists,
+ * so the input to the neurons is summed in the same order as before.
+ */
+void Network::compact() {
+	sweep();
+	if (!pruned_pending) return;
+	merge();
+	NEURONS::iterator n_it;
+	for (n_it = neurons.begin(); n_it != neurons.end(); ++n_it) {
+		SYNAPSES *outgoing = (*n_it)->outgoing;
+		if (outgoing == NULL) continue;
+		SYNAPSES::iterator last = std::remove_if(outgoing->begin(), outgoing->end(), isPruned);
+		if (last == outgoing->end()) continue;
+		outgoing->erase(last, outgoing->end());
+		SYNAPSES(*outgoing).swap(*outgoing);
+	}
+	SYNAPSES::iterator s_it, last = synapses.begin();
+	for (s_it = synapses.begin(); s_it != synapses.end(); ++s_it) {
+		if (!(*s_it)->pruned) *last++ = *s_it;
+		else if (!inBlock(*s_it)) delete *s_it;
+	}
+	synapses.erase(last, synapses.end());
+	SYNAPSES(synapses).swap(synapses);
+	pruned_pending = 0;
+	incoming_stale = true;
+	++generation;
+}
+
+void Network::setStatsDump(int interval, std::ostream & out) {
+	stats_interval = interval;
+	stats_out = &out;
+}
+
+/**
+ * With NETWORK_STATS every phase is timed separately. Wall clock time is measured as well, so
+ * the cycles can be turned into synaptic operations per second.
+ */
 void Network::tick() {
+#ifdef NETWORK_STATS
+	struct timespec ts_start, ts_end;
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+#endif
+	STATS_START(NP_UPKEEP);
+	if (added_neurons.size() + added_synapses.size() > pendingLimit()) merge();
+	STATS_STOP(NP_UPKEEP);
 	++t;
+	STATS_START(NP_SPIKES);
 	updateSpikes();
+	STATS_STOP(NP_SPIKES);
+	STATS_START(NP_SYNAPSES);
 	updateSynapses();
+	STATS_STOP(NP_SYNAPSES);
+	STATS_START(NP_NEURONS);
 	updateNeurons();
+	STATS_STOP(NP_NEURONS);
+	if ((prune_ticks || pruned_pending) && compact_interval > 0 && !(t % compact_interval)) {
+		STATS_START(NP_UPKEEP);
+		compact();
+		STATS_STOP(NP_UPKEEP);
+	}
+#ifdef NETWORK_STATS
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	stats.wall_ns += (ts_end.tv_sec - ts_start.tv_sec) * 1e9 + (ts_end.tv_nsec - ts_start.tv_nsec);
+	stats.ticks++;
+	if (stats_interval > 0 && !(t % stats_interval)) {
+		*stats_out << "[t=" << t << "] ";
+		stats.print(*stats_out);
+	}
+#endif
+}
+
+int Network::run(int ticks) {
+	for (int i = 0; i < ticks; ++i) {
+		tick();
+	}
+	return ticks;
 }
 
+//! The neurons that have been added while running are visited without merging them
 int Network::getSpikes(std::vector<bool> & activity) {
-	NEURONS::iterator it;
-	activity.clear();
+	activity.assign(getNeuronCount(), false);
 	int r = 0;
-	for (it = neurons.begin(); it != neurons.end(); ++it) {
-		bool raised = (*it)->raised();
-		activity.push_back(raised);
+	for (int k = 0; k < getNeuronCount(); ++k) {
+		ConnNeuron *cn = at(k);
+		bool raised = cn->raised();
+		activity[cn->id] = raised;
 		if (raised) ++r;
 	}
-	assert (activity.size() == neurons.size());
 	return r;
 }
 
 void Network::updateSpikes() {
+	fired.clear();
+	switch (history_words) {
+	case 1: advance<1>(); break;
+	case 2: advance<2>(); break;
+	default: advance<0>();
+	}
+	// the ids are only in order if the neurons have not been reordered
+	if (!position.empty()) std::sort(fired.begin(), fired.end());
+	if (input == NULL) return;
+
+	// spikes that are scheduled externally, merged so the fired list stays sorted
+	const std::vector<int> & scheduled = input->spikes(t);
+	size_t count = fired.size();
+	std::vector<int>::const_iterator s_it;
+	for (s_it = scheduled.begin(); s_it != scheduled.end(); ++s_it) {
+		assert (*s_it >= 0 && *s_it < getNeuronCount());
+		ConnNeuron *cn = neuron(*s_it);
+		if (cn->raised()) continue;
+		cn->raise();
+		fired.push_back(cn->id);
+		STATS_COUNT(spikes, 1);
+	}
+	std::inplace_merge(fired.begin(), fired.begin() + count, fired.end());
+}
+
+template <int Words>
+void Network::advance() {
 	NEURONS::iterator it;
 	for (it = neurons.begin(); it != neurons.end(); ++it) {
-		(*it)->advance();
-		if ((*it)->neuron->fired()) (*it)->raise();
+		updateSpike<Words>(*it);
+	}
+	for (it = added_neurons.begin(); it != added_neurons.end(); ++it) {
+		updateSpike<Words>(*it);
+	}
+}
+
+template <int Words>
+void Network::updateSpike(ConnNeuron *cn) {
+	advanceHistory<Words>(cn, history_words, history_mask);
+	if (cn->neuron->fired()) {
+		cn->raise();
+		fired.push_back(cn->id);
+		STATS_COUNT(spikes, 1);
 	}
 }
 
 /**
  * Updated function after Freek's suggestions. Needs to be tested.
+ *
+ * A synapse can only deliver a spike or change its weight if its pre-synaptic neuron fired in the
+ * maximum delay (it arrives now, or it is the most recent pre-synaptic spike for a post-
+ * synaptic one), and its post-synaptic neuron as well (it fires now, or it is the most recent post-
+ * synaptic spike for an arriving one). A push visits the outgoing synapses of the active neurons,
+ * a pull the incoming ones. Every post-synaptic neuron gets its input from its incoming synapses
+ * in the same order as in a scan, so the sums, and with them the dynamics, are exactly the same.
  */
 void Network::updateSynapses() {
-	SYNAPSES::iterator it;
-	for (it = synapses.begin(); it != synapses.end(); ++it) {
-		// adjust only excitatory connections
-		if ((*it)->pre->neuron->getSign() == NS_INHIBITORY) continue;
-
-		// if a pre-synaptic spike reaches the post-synaptic neuron
-		if ((*it)->pre->raised((*it)->delay)) {
-			// apply LTD with the most recent post-synaptic spike
-			int first_spike = (*it)->post->first();
-			if (first_spike >= 0) {
-				(*it)->weight += 0.12 * exp(+first_spike/(NN_VALUE)HISTORY_SIZE);
-				// increase the post-synaptic neuron's input
-				// TODO: I forgot where this factor 3 comes from, have to check that
-				(*it)->post->input += (*it)->weight / NN_VALUE(3);
+	switch (history_words) {
+	case 1: propagate<1>(); break;
+	case 2: propagate<2>(); break;
+	default: propagate<0>();
+	}
+}
+
+template <int Words>
+void Network::propagate() {
+	DeliveryMode mode = delivery;
+	long push = 0, pull = 0;
+	if (mode != DM_SCAN) {
+		updateActive<Words>(push, pull);
+		if (mode == DM_AUTO) mode = (pull < push) ? DM_PULL : DM_PUSH;
+	}
+	last_delivery = mode;
+
+	NEURONS::iterator n_it;
+	std::vector<int>::iterator a_it;
+	SynapseCounts counts;
+	switch (mode) {
+	case DM_PUSH:
+		STATS_COUNT(pushes, 1);
+		if (splitTasks(push, true) > 1) {
+			task_inputs.resize(tasks.size());
+			task_counts.resize(tasks.size());
+			#pragma omp parallel for schedule(dynamic, 1)
+			for (int i = 0; i < (int)tasks.size(); ++i) {
+				pushTask<Words>(i, task_inputs[i], task_counts[i]);
+			}
+			// the tasks follow each other in the order of a scan, so adding their input in the
+			// same order gives the same sums
+			for (size_t i = 0; i < tasks.size(); ++i) {
+				std::vector<Delivered>::iterator d_it;
+				for (d_it = task_inputs[i].begin(); d_it != task_inputs[i].end(); ++d_it) {
+					deliver(d_it->post, d_it->input);
+				}
+				counts.add(task_counts[i]);
+			}
+			break;
+		}
+		for (a_it = active.begin(); a_it != active.end(); ++a_it) {
+			updateOutgoing<Words>(at(*a_it), counts);
+		}
+		break;
+	case DM_PULL:
+		STATS_COUNT(pulls, 1);
+		if (splitTasks(pull, false) > 1) {
+			task_counts.resize(tasks.size());
+			#pragma omp parallel for schedule(dynamic, 1)
+			for (int i = 0; i < (int)tasks.size(); ++i) {
+				pullTask<Words>(i, task_counts[i]);
 			}
+			for (size_t i = 0; i < tasks.size(); ++i) counts.add(task_counts[i]);
+			break;
+		}
+		for (a_it = active.begin(); a_it != active.end(); ++a_it) {
+			updateIncoming<Words>(*a_it, counts);
+		}
+		break;
+	default:
+		for (n_it = neurons.begin(); n_it != neurons.end(); ++n_it) {
+			updateOutgoing<Words>(*n_it, counts);
+		}
+		for (n_it = added_neurons.begin(); n_it != added_neurons.end(); ++n_it) {
+			updateOutgoing<Words>(*n_it, counts);
+		}
+	}
+	STATS_ADD(counts);
+	if (!inhibition) return;
+
+	if (mode == DM_SCAN) {
+		for (n_it = neurons.begin(); n_it != neurons.end(); ++n_it) {
+			updateInhibitory<Words>(*n_it);
+		}
+		for (n_it = added_neurons.begin(); n_it != added_neurons.end(); ++n_it) {
+			updateInhibitory<Words>(*n_it);
+		}
+	} else {
+		for (a_it = active.begin(); a_it != active.end(); ++a_it) {
+			updateInhibitory<Words>(at(*a_it));
+		}
+	}
+}
+
+/**
+ * The number of synapses to visit for a pull is only known for an up to date list of incoming
+ * synapses, so that is built first, also if a push turns out to be cheaper.
+ */
+template <int Words>
+void Network::updateActive(long & push, long & pull) {
+	if (incoming_stale) updateIncomingLists();
+	active.clear();
+	push = pull = 0;
+	int n = getNeuronCount();
+	for (int k = 0; k < n; ++k) {
+		ConnNeuron *cn = at(k);
+		if (!isActive<Words>(cn, history_words)) continue;
+		active.push_back(k);
+		if (cn->outgoing != NULL && cn->neuron->getSign() != NS_INHIBITORY)
+			push += cn->outgoing->size();
+		pull += incomingCount(k);
+	}
+}
+
+void Network::updateIncomingLists() {
+	int n = getNeuronCount();
+	incoming_offset.assign(n + 1, 0);
+	SYNAPSES::iterator it;
+	for (int k = 0; k < n; ++k) {
+		ConnNeuron *cn = at(k);
+		if (cn->outgoing == NULL || cn->neuron->getSign() == NS_INHIBITORY) continue;
+		for (it = cn->outgoing->begin(); it != cn->outgoing->end(); ++it) {
+			++incoming_offset[getPosition((*it)->post->id) + 1];
+		}
+	}
+	for (int k = 0; k < n; ++k) incoming_offset[k + 1] += incoming_offset[k];
+	incoming.resize(incoming_offset[n]);
+	std::vector<long> fill(incoming_offset.begin(), incoming_offset.end() - 1);
+	for (int k = 0; k < n; ++k) {
+		ConnNeuron *cn = at(k);
+		if (cn->outgoing == NULL || cn->neuron->getSign() == NS_INHIBITORY) continue;
+		for (it = cn->outgoing->begin(); it != cn->outgoing->end(); ++it) {
+			incoming[fill[getPosition((*it)->post->id)]++] = *it;
 		}
-		// if a post-synaptic spike occurs
-		if ((*it)->post->raised()) {
-			// apply LTP with the most recent pre-synaptic spike that has arrived at the post-synaptic neuron,
-			// so occurred at least "delay" ms ago
-			int first_spike = (*it)->pre->first((*it)->delay);
-			if (first_spike >= 0) {
-				(*it)->weight -= 0.10 * exp(-first_spike/(NN_VALUE)HISTORY_SIZE);
+	}
+	incoming_added.clear();
+	incoming_stale = false;
+}
+
+//! Only excitatory synapses deliver spikes and adapt their weights
+template <int Words>
+void Network::updateOutgoing(ConnNeuron *cn, SynapseCounts & counts) {
+	if (cn->outgoing == NULL || cn->neuron->getSign() == NS_INHIBITORY) return;
+	SYNAPSES::iterator it;
+	NN_VALUE delivered;
+	for (it = cn->outgoing->begin(); it != cn->outgoing->end(); ++it) {
+		if (updateSynapse<Words>(*it, delivered, counts)) deliver((*it)->post, delivered);
+	}
+}
+
+/**
+ * Inhibitory synapses are not plastic, and pruned synapses are excitatory. The same factor 3 as
+ * for the excitatory synapses is used, the state of the GABA receptors is positive. The input is
+ * added after that of all excitatory synapses, in every delivery mode.
+ */
+template <int Words>
+void Network::updateInhibitory(ConnNeuron *cn) {
+	if (cn->outgoing == NULL || cn->neuron->getSign() != NS_INHIBITORY) return;
+	if (!isActive<Words>(cn, history_words)) return;
+	SYNAPSES::iterator it;
+	for (it = cn->outgoing->begin(); it != cn->outgoing->end(); ++it) {
+		if (!raisedAt<Words>(cn, (*it)->delay)) continue;
+		if (dynamics == SD_INSTANT) (*it)->post->input += (*it)->weight / NN_VALUE(3);
+		else (*it)->post->receptor[SR_GABA] -= (*it)->weight / NN_VALUE(3);
+		STATS_COUNT(events, 1);
+	}
+}
+
+/**
+ * The synapses that have been added since the lists were built are merged with the others by the
+ * position of their pre-synaptic neuron, so the input is summed in the order of a scan.
+ */
+template <int Words>
+void Network::updateIncoming(int k, SynapseCounts & counts) {
+	Synapse **it = NULL, **end = NULL, **added = NULL, **added_end = NULL;
+	if (k + 1 < (int)incoming_offset.size() && incoming_offset[k] < incoming_offset[k + 1]) {
+		it = &incoming[incoming_offset[k]];
+		end = it + (incoming_offset[k + 1] - incoming_offset[k]);
+	}
+	if (k < (int)incoming_added.size() && !incoming_added[k].empty()) {
+		added = &incoming_added[k][0];
+		added_end = added + incoming_added[k].size();
+	}
+	NN_VALUE delivered;
+	while (it != end || added != added_end) {
+		Synapse *synapse;
+		if (added == added_end || (it != end &&
+				getPosition((*it)->pre->id) <= getPosition((*added)->pre->id)))
+			synapse = *it++;
+		else
+			synapse = *added++;
+		if (!isActive<Words>(synapse->pre, history_words)) continue;
+		if (updateSynapse<Words>(synapse, delivered, counts)) deliver(synapse->post, delivered);
+	}
+}
+
+/**
+ * In a burst a few neurons may have most of the synapses to visit, so the tasks are cut by the
+ * number of synapses and not by the number of neurons. A push can cut the outgoing synapses of
+ * a neuron in several tasks, because the input is buffered per task. A pull can not, a neuron
+ * gets its input from a single task. There are a few tasks per thread, which are handed out to
+ * the threads dynamically, so a thread that has been given the synapses of the quiet neurons
+ * takes over tasks that are still waiting. Returns 1 if the work is too small to divide.
+ */
+int Network::splitTasks(long work, bool push) {
+	int threads = 1;
+#ifdef _OPENMP
+	threads = omp_get_max_threads();
+#endif
+	if (threads < 2 || parallel_grain <= 0 || work < 2 * parallel_grain) return 1;
+	long size = std::max(parallel_grain, work / (threads * TasksPerThread));
+	long left = size;
+	tasks.clear();
+	tasks.push_back(DeliveryTask(0, 0));
+	for (int a = 0; a < (int)active.size(); ++a) {
+		if (push) {
+			ConnNeuron *cn = at(active[a]);
+			if (cn->outgoing == NULL || cn->neuron->getSign() == NS_INHIBITORY) continue;
+			long count = cn->outgoing->size();
+			long first = 0;
+			while (count - first > left) {
+				first += left;
+				left = size;
+				tasks.push_back(DeliveryTask(a, first));
+			}
+			left -= count - first;
+		} else {
+			if (left <= 0) {
+				tasks.push_back(DeliveryTask(a, 0));
+				left = size;
 			}
+			left -= incomingCount(active[a]);
+		}
+	}
+	return tasks.size();
+}
+
+/**
+ * The counters are kept on the stack while the task runs, so the threads do not write to the same
+ * cache lines.
+ */
+template <int Words>
+void Network::pushTask(size_t i, std::vector<Delivered> & inputs, SynapseCounts & counts) {
+	SynapseCounts local;
+	DeliveryTask from = tasks[i];
+	DeliveryTask to = (i + 1 < tasks.size()) ? tasks[i + 1] : DeliveryTask(active.size(), 0);
+	inputs.clear();
+	NN_VALUE delivered;
+	for (int a = from.active; a <= to.active && a < (int)active.size(); ++a) {
+		ConnNeuron *cn = at(active[a]);
+		if (cn->outgoing == NULL || cn->neuron->getSign() == NS_INHIBITORY) continue;
+		long first = (a == from.active) ? from.synapse : 0;
+		long last = (a == to.active) ? to.synapse : (long)cn->outgoing->size();
+		for (long j = first; j < last; ++j) {
+			Synapse *synapse = (*cn->outgoing)[j];
+			if (updateSynapse<Words>(synapse, delivered, local))
+				inputs.push_back(Delivered(synapse->post, delivered));
+		}
+	}
+	counts = local;
+}
+
+template <int Words>
+void Network::pullTask(size_t i, SynapseCounts & counts) {
+	SynapseCounts local;
+	int last = (i + 1 < tasks.size()) ? tasks[i + 1].active : active.size();
+	for (int a = tasks[i].active; a < last; ++a) {
+		updateIncoming<Words>(active[a], local);
+	}
+	counts = local;
+}
+
+/**
+ * A synapse that would have been pruned in an earlier tick, if it had been visited, is skipped.
+ * One that expires in this tick is updated first, as in a scan, see prune(). The input is returned rather than added, so that tasks that run in parallel can buffer it.
+ */
+template <int Words>
+bool Network::updateSynapse(Synapse *synapse, NN_VALUE & delivered, SynapseCounts & counts) {
+	if (synapse->pruned) return false;
+	if (prune_ticks && expired(synapse, t - 1)) {
+		synapse->pruned = true;
+		#pragma omp atomic
+		++pruned_count;
+		#pragma omp atomic
+		++pruned_pending;
+		return false;
+	}
+
+	bool arrived = false;
+
+	// if a pre-synaptic spike reaches the post-synaptic neuron
+	if (raisedAt<Words>(synapse->pre, synapse->delay)) {
+		// apply LTD with the most recent post-synaptic spike
+		int first_spike = firstAt<Words>(synapse->post, 0, history_words);
+		if (first_spike >= 0) {
+			synapse->weight += stdp_ltd[first_spike];
+			// increase the post-synaptic neuron's input
+			// TODO: I forgot where this factor 3 comes from, have to check that
+			delivered = synapse->weight / NN_VALUE(3);
+			arrived = true;
+			STATS_COUNT_IN(counts, ltd, 1);
+			STATS_COUNT_IN(counts, events, 1);
 		}
+	}
+	// if a post-synaptic spike occurs
+	if (synapse->post->raised()) {
+		// apply LTP with the most recent pre-synaptic spike that has arrived at the post-synaptic neuron,
+		// so occurred at least "delay" ms ago
+		int first_spike = firstAt<Words>(synapse->pre, synapse->delay, history_words);
+		if (first_spike >= 0) {
+			synapse->weight -= stdp_ltp[first_spike];
+			STATS_COUNT_IN(counts, ltp, 1);
+		}
+	}
+
+	if (synapse->weight > 10.0) {
+		synapse->weight = 10.0;
+		STATS_COUNT_IN(counts, clamped, 1);
+	}
+	if (synapse->weight < -10.0) {
+		synapse->weight = -10.0;
+		STATS_COUNT_IN(counts, clamped, 1);
+	}
+
+	if (prune_ticks) prune(synapse);
+	return arrived;
+}
 
-		if ((*it)->weight > 10.0)
-			(*it)->weight = 10.0;
-		if ((*it)->weight < -10.0)
-			(*it)->weight = -10.0;
+/**
+ * Only excitatory synapses are plastic, so only those are pruned.
+ */
+void Network::prune(Synapse *synapse) {
+	if (synapse->weight > prune_floor) {
+		synapse->floor_since = -1;
+		return;
 	}
+	if (synapse->floor_since < 0) synapse->floor_since = t;
+	if (!expired(synapse, t)) return;
+	synapse->pruned = true;
+	#pragma omp atomic
+	++pruned_count;
+	#pragma omp atomic
+	++pruned_pending;
 }
 
 /**
@@ -195,20 +1209,50 @@ void Network::updateSynapses() {
  * previously calculated in propagateSpikes. In the case of a neuron with 8 simultaneously
  * spiking input neurons, this figure might become the summation of all weights, say
  * 8*6 = 48 mA.
+ * Input neurons are only updated if there is a current frame for this tick, with the j-th
+ * current in the frame for the j-th input neuron. They fire at the next tick, as other neurons.
  */
 void Network::updateNeurons() {
 	NEURONS::iterator it;
+	const NN_VALUE *frame = (input != NULL) ? input->currents(t) : NULL;
+	int j = 0;
 	for (it = neurons.begin(); it != neurons.end(); ++it) {
-		assert ((*it)->neuron != NULL);
-		if ((*it)->neuron->getLoc() != NL_INPUT) {
-			(*it)->neuron->update((*it)->input);
+		updateNeuron(*it, frame, j);
+	}
+	for (it = added_neurons.begin(); it != added_neurons.end(); ++it) {
+		updateNeuron(*it, frame, j);
+	}
+}
 
-			//! the reset value is 20 half of the cases to represent random thalamic input
-			if (drand48() < 0.5)
-				(*it)->input = 0;
-			else
-				(*it)->input = 20;
+void Network::updateNeuron(ConnNeuron *cn, const NN_VALUE *frame, int & j) {
+	assert (cn->neuron != NULL);
+	if (cn->neuron->getLoc() == NL_INPUT) {
+		if (frame != NULL)
+			cn->neuron->update(frame[input_slots.empty() ? j : input_slots[cn->id]]);
+		else
+			cn->neuron->silence();
+		++j;
+	} else {
+		NN_VALUE current = cn->input;
+		if (dynamics != SD_INSTANT) {
+			NN_VALUE v = cn->neuron->getPotential();
+			for (int r = 0; r < SR_COUNT; ++r) {
+				NN_VALUE drive = (1 - receptor_decay[r]) * cn->receptor[r];
+				if (dynamics == SD_CONDUCTANCE)
+					drive *= (ReversalPotential[r] - v) / fabs(ReversalPotential[r] - RestingPotential);
+				else if (r == SR_GABA)
+					drive = -drive;
+				current += drive;
+				cn->receptor[r] *= receptor_decay[r];
+			}
 		}
+		cn->neuron->update(current);
+
+		//! the reset value is 20 half of the cases to represent random thalamic input
+		if (uniform() < 0.5)
+			cn->input = 0;
+		else
+			cn->input = 20;
 	}
 }
 
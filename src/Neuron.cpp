@@ -66,6 +66,7 @@ Neuron::Neuron(NeuronType type, NeuronSign sign, NeuronLocation loc) {
 	c = NeuronConfig[type][2];
 	d = NeuronConfig[type][3];
 	v = -65.0; u = v * b;
+	spike = false;
 }
 
 /**
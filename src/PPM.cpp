@@ -0,0 +1,69 @@
+/**
+ * @file PPM.cpp
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+// General files
+#include <PPM.h>
+
+using namespace std;
+
+/* **************************************************************************************
+ * Implementation of ColourMap
+ * **************************************************************************************/
+
+const ColourMap & ColourMap::instance() {
+	static ColourMap map;
+	return map;
+}
+
+/**
+ * Entry v + 1 holds the colour of the scaled value v, entry 0 is black for negative values and
+ * the last one red for values that are out of range.
+ */
+ColourMap::ColourMap() {
+	for (int v = 0; v < Colours; ++v) {
+		unsigned char *rgb = table[v + 1];
+		if (v < 256) {
+			rgb[0] = 0; rgb[1] = v; rgb[2] = 255;			// 0 b is bluest, and up to g+b=cyan
+		} else if (v < 511) {
+			rgb[0] = 0; rgb[1] = 255; rgb[2] = 511 - v;		// 255 is g+b=cyan, 511 g is greenest
+		} else if (v < 766) {
+			rgb[0] = v - 511; rgb[1] = 255; rgb[2] = 0;		// 511 g is greenest, 765 is r+g=yellow
+		} else {
+			rgb[0] = 255; rgb[1] = 1020 - v; rgb[2] = 0;	// 765 is r+g=yellow, 1020 is reddest
+		}
+	}
+	table[0][0] = table[0][1] = table[0][2] = 0;
+	table[Colours + 1][0] = 255;
+	table[Colours + 1][1] = table[Colours + 1][2] = 0;
+}
+
+/* **************************************************************************************
+ * Implementation of PPM
+ * **************************************************************************************/
+
+bool WritePPM(const std::string & file, const DataContainer & data) {
+	size_t height = data.height();
+	size_t width = height ? data.size() / height : 0;
+	return WritePPM(file, width, height, ContainerRaster(data));
+}
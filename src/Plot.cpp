@@ -24,12 +24,14 @@
 
 // General files
 #include <Plot.h>
+#include <PPM.h>
 #include <math.h>
 #include <iostream>
 #include <fstream>
 #include <assert.h>
 #include <algorithm>
 #include <vector>
+#include <unistd.h>
 
 #include <boost/lexical_cast.hpp>
 
@@ -58,6 +60,7 @@ Plot::Plot() {
 	plot_type = PT_DEFAULT;
 
 	dimensions_set = false;
+	resolution = 1000;
 }
 
 //! Get the data
@@ -179,63 +182,25 @@ PLFLT Plot::Scale(const PLFLT input, bool x_axis) {
 }
 
 /**
- * Draw a PPM figure. This is a colour plot with length and width sqrt(data->size). It
- * expects values in the range [0..1] and will multiple them by 255 to obtain chars.
- * Subsequently they are put into four bins, each given a certain main colour, but with
- * the colours gradually changing from bin to bin.
+ * Draw a PPM figure. This is a colour plot with a column of pixels per column of data. It
+ * expects values in the range [0..1] and will multiply them by 1020. Subsequently they are
+ * put into four bins, each given a certain main colour, but with the colours gradually
+ * changing from bin to bin, see ColourMap.
  */
 void Plot::DrawPPM() {
-	FILE *stream;
-	string file = path + ppm_file + ".ppm";
-	stream = fopen(file.c_str(), "wb" );
-
-	int height = GetData().height();
-	int width = GetData().size() / height;
-	fprintf( stream, "P6\n%d %d\n255\n", width, height);
-
-	int sections = 4; int nof_colors = sections*255;
-	char rgb[3];
-	for(int j = 0; j < height; ++j) {
-		for (int i = 0; i < width; ++i) {
-			DataItem *item = GetData().getItem(j+i*height);
-//			float value = GetData().item< float >(i+j*width) * nof_colors;
-			float value = item->value * nof_colors;
-			if(value < 0) {
-				rgb[0] = 0;
-				rgb[1] = 0;
-				rgb[2] = 0;
-			} else
-				if(value < 256)
-				{
-					rgb[0] = 0;
-					rgb[1] = value; // 0 b is bluest, and up to g+b=cyan
-					rgb[2] = 255;
-				}
-				else if(value < 511)
-				{
-					rgb[0] = 0;
-					rgb[1] = 255;
-					rgb[2] = 511 - value; // 255 is g+b=cyan, 511 g is greenest
-				}
-				else if (value < 766)
-				{
-					rgb[0] = value - 511;
-					rgb[1] = 255; // 511 g is greenest, 765 is r+g=yellow
-					rgb[2] = 0;
-				}
-				else if (value < 1021)
-				{
-					rgb[0] = 255;
-					rgb[1] = 1020 - value; // 765 is r+g=yellow, 1020 is reddest
-					rgb[2] = 0;
-				}
-			// 511 is r+g=yellow, 765 is reddest
-			fwrite(&rgb[0], 1, 1, stream);
-			fwrite(&rgb[1], 1, 1, stream);
-			fwrite(&rgb[2], 1, 1, stream);
-		}
-	}
-	fclose( stream );
+	DrawPPM(path + ppm_file + ".ppm");
+}
+
+/**
+ * A snapshot does not change the data, so with a window (see DataContainer::setWindow) a long
+ * run can be monitored by taking snapshots every so many ticks.
+ */
+void Plot::Snapshot(const std::string & suffix) {
+	DrawPPM(path + ppm_file + suffix + ".ppm");
+}
+
+void Plot::DrawPPM(const std::string & file) {
+	WritePPM(file, GetData());
 }
 
 /**
@@ -247,8 +212,8 @@ void Plot::GetData(DataContainer &container, PLData & pld) {
 		cerr << "No data available!" << endl;
 		return;
 	}
-	pld.x_axis = new PLFLT[pld.len];
-	pld.y_axis = new PLFLT[pld.len];
+	pld.x_axis.resize(pld.len);
+	pld.y_axis.resize(pld.len);
 	assert (container.GetID() >= 0);
 	pld.id = container.GetID();
 
@@ -256,9 +221,9 @@ void Plot::GetData(DataContainer &container, PLData & pld) {
 	case PT_DEFAULT:
 		//		cout << "Plot values" << endl;
 		for (int i = 0; i < pld.len; ++i) {
-			DataItem *item = container.getItem(i);
-			DC_TYPE x = item->value;
-			int y = item->coord_y;
+			DataItem item = container.getItem(i);
+			DC_TYPE x = item.value;
+			int y = item.coord_y;
 			pld.x_axis[i] = Scale(x, true);
 			pld.y_axis[i] = Scale(y, false);
 		}
@@ -270,9 +235,9 @@ void Plot::GetData(DataContainer &container, PLData & pld) {
 		for (int i = 0; i < pld.len; ++i) {
 //			pair<DataDecoratorType,int> item = cont.item< pair<DataDecoratorType,int> >(i);
 //			int y = item.second;
-			DataItem *item = container.getItem(i);
-			DC_TYPE x = item->value;
-			int y = item->coord_y;
+			DataItem item = container.getItem(i);
+			DC_TYPE x = item.value;
+			int y = item.coord_y;
 			N += y;
 		}
 #ifdef VERBOSE
@@ -285,9 +250,9 @@ void Plot::GetData(DataContainer &container, PLData & pld) {
 		long int sum = 0;
 		for (int i = 0; i < pld.len; ++i) {
 			int index = (reverse_cdf ? pld.len - 1 - i : i);
-			DataItem *item = container.getItem(i);
-			DC_TYPE x = item->value;
-			int y = item->coord_y;
+			DataItem item = container.getItem(i);
+			DC_TYPE x = item.value;
+			int y = item.coord_y;
 //			pair<DataDecoratorType,int> item = cont.item< pair<DataDecoratorType,int> >(index);
 //			DataDecoratorType x = item.first;
 //			int y = item.second;
@@ -319,12 +284,7 @@ void Plot::GetData(DataContainer &container, PLData & pld) {
 		cout << "Integration of density plot: " << lazy_integration << " (should be around 1)" << endl;
 	}
 
-	if (!dimensions_set) {
-		pld.x_min = *min_element(pld.x_axis,pld.x_axis+pld.len);
-		pld.x_max = *max_element(pld.x_axis,pld.x_axis+pld.len);
-		pld.y_min = *min_element(pld.y_axis,pld.y_axis+pld.len);
-		pld.y_max = *max_element(pld.y_axis,pld.y_axis+pld.len);
-	}
+	if (!dimensions_set) Bounds(pld);
 
 	// Remove all values smaller than 1/resolution of the maximum value
 	bool remove_below_resolution = false;
@@ -350,13 +310,58 @@ void Plot::GetData(DataContainer &container, PLData & pld) {
 		}
 		pld.len = j;
 
-		if (!dimensions_set) {
-			pld.x_min = *min_element(pld.x_axis,pld.x_axis+pld.len);
-			pld.x_max = *max_element(pld.x_axis,pld.x_axis+pld.len);
-			pld.y_min = *min_element(pld.y_axis,pld.y_axis+pld.len);
-			pld.y_max = *max_element(pld.y_axis,pld.y_axis+pld.len);
+		if (!dimensions_set) Bounds(pld);
+	}
+}
+
+void Plot::Bounds(PLData & pld) {
+	pld.x_min = pld.x_max = pld.x_axis[0];
+	pld.y_min = pld.y_max = pld.y_axis[0];
+	for (int i = 1; i < pld.len; ++i) {
+		PLFLT x = pld.x_axis[i], y = pld.y_axis[i];
+		if (x < pld.x_min) pld.x_min = x;
+		if (x > pld.x_max) pld.x_max = x;
+		if (y < pld.y_min) pld.y_min = y;
+		if (y > pld.y_max) pld.y_max = y;
+	}
+}
+
+/**
+ * A run of consecutive points that fall in the same pixel column is drawn as a vertical stroke,
+ * which is the same for its first and last point and the points with the minimum and maximum y
+ * (in their order). So only those are kept, in place, in a single pass. Points left and right of
+ * the window all fall in one column at either side, so the lines towards the window remain.
+ */
+void Plot::Decimate(PLData & pld, PLFLT x_min, PLFLT x_max) {
+	if (resolution <= 0 || pld.len <= 4 * resolution || x_max <= x_min) return;
+	PLFLT *x = &pld.x_axis[0], *y = &pld.y_axis[0];
+	PLFLT columns_per_x = resolution / (x_max - x_min);
+	int len = 0;
+	int first = 0;
+	while (first < pld.len) {
+		PLFLT column = floor((x[first] - x_min) * columns_per_x);
+		if (column < -1) column = -1;
+		if (column > resolution) column = resolution;
+		int last = first, lowest = first, highest = first;
+		while (last + 1 < pld.len) {
+			PLFLT next = floor((x[last + 1] - x_min) * columns_per_x);
+			if (next < -1) next = -1;
+			if (next > resolution) next = resolution;
+			if (next != column) break;
+			++last;
+			if (y[last] < y[lowest]) lowest = last;
+			if (y[last] > y[highest]) highest = last;
+		}
+		int keep[4] = { first, std::min(lowest, highest), std::max(lowest, highest), last };
+		for (int k = 0; k < 4; ++k) {
+			if (k && keep[k] == keep[k-1]) continue;
+			x[len] = x[keep[k]];
+			y[len] = y[keep[k]];
+			++len;
 		}
+		first = last + 1;
 	}
+	pld.len = len;
 }
 
 /**
@@ -373,8 +378,7 @@ void Plot::DrawPLPlot() {
 		return;
 	}
 
-	std::vector<PLData> plds;
-
+	size_t graphs = 0;
 	std::vector<DataContainer*>::iterator d_i;
 	for (d_i = data_v.begin(); d_i != data_v.end(); ++d_i) {
 		if (plot_type == PT_DENSITY) {
@@ -390,7 +394,8 @@ void Plot::DrawPLPlot() {
 
 //			(*d_i)->write(std::cout);
 		}
-		PLData pld;
+		if (graphs == plds.size()) plds.push_back(PLData());
+		PLData & pld = plds[graphs];
 		GetData(**d_i, pld);
 		if (pld.len == 0) {
 			cerr << "No data available, has SetData been called?" << endl;
@@ -400,10 +405,10 @@ void Plot::DrawPLPlot() {
 			cerr << "Just one data point. Does not make sense to make a plot!" << endl;
 			continue;
 		}
-		plds.push_back(pld);
+		++graphs;
 	}
 
-	if (plds.empty()) {
+	if (!graphs) {
 		cerr << "No data available, empty files?" << endl;
 		return;
 	}
@@ -422,9 +427,8 @@ void Plot::DrawPLPlot() {
 		ly_min = pld.y_min;
 		ly_max = pld.y_max;
 
-		std::vector<PLData>::iterator p_i;
-		for (p_i = plds.begin(); p_i != plds.end(); ++p_i) {
-			PLData & pld = *p_i;
+		for (size_t i = 1; i < graphs; ++i) {
+			PLData & pld = plds[i];
 			if (pld.x_min < lx_min) lx_min = pld.x_min;
 			if (pld.x_max > lx_max) lx_max = pld.x_max;
 			if (pld.y_min < ly_min) ly_min = pld.y_min;
@@ -479,6 +483,13 @@ void Plot::DrawPLPlot() {
 	// Plot as line
 	bool plot_as_line = true;
 
+	// Of a line only a few points per pixel column are visible
+	if (plot_as_line) {
+		for (size_t i = 0; i < graphs; ++i) {
+			Decimate(plds[i], lx_min - x_border, lx_max + x_border);
+		}
+	}
+
 	// Add labels (and the legend)
 	pls->col0( DeepBlue );
 	pls->mtex( "b", 3.2, 0.5, 0.5, x_label.c_str() );
@@ -487,9 +498,8 @@ void Plot::DrawPLPlot() {
 
     int legend_id = 1;
 	// Actually do the drawing
-	std::vector<PLData>::iterator p_i;
-	for (p_i = plds.begin(); p_i != plds.end(); ++p_i) {
-		PLData & pld = *p_i;
+	for (size_t i = 0; i < graphs; ++i) {
+		PLData & pld = plds[i];
 
 		// Set colour of the line to the next one
 		colour+=1;
@@ -504,45 +514,44 @@ void Plot::DrawPLPlot() {
 //		} else {
 			if (plot_as_line) {
 				pls->lsty( style );
-				pls->line( pld.len, pld.x_axis, pld.y_axis );
+				pls->line( pld.len, &pld.x_axis[0], &pld.y_axis[0] );
 			} else {
-				pls->poin( pld.len, pld.x_axis, pld.y_axis, sign );
+				pls->poin( pld.len, &pld.x_axis[0], &pld.y_axis[0], sign );
 			}
 //		}
 
 		string y_run = y_label + " [" + boost::lexical_cast<std::string>(pld.id) + "]";
 		pls->mtex( "t", -(++legend_id*1.5), 0.9, 0.0, y_run.c_str() );
 	}
+}
 
-	// Remove arrays
-	for (p_i = plds.begin(); p_i != plds.end(); ++p_i) {
-		PLData & pld = *p_i;
-		delete [] pld.x_axis;
-		delete [] pld.y_axis;
+/**
+ * Store the data for the files, container i in <path><svg_file>.<i>.dc, see DataContainer::write
+ * for the format. Load() reads them back, so a run on another machine can be plotted here.
+ */
+bool Plot::Store() {
+	bool stored = true;
+	for (size_t i = 0; i < data_v.size(); ++i) {
+		stored &= data_v[i]->write(StoreName(i));
 	}
+	return stored;
 }
 
 /**
- * Store the data for the files
+ * The files are mapped, so loading is cheap whatever their size, see DataContainer::map.
  */
-void Plot::Store() {
-//	std::vector<DataContainer*>::iterator d_i;
-//	for (d_i = data_v.begin(); d_i != data_v.end(); ++d_i) {
-//		string pfile = path + svg_file + ".data";
-//		ofstream ofile;
-//		ofile.open(pfile.c_str());
-//		(*d_i)->write(ofile);
-//		ofile.close(); //! need to close it, or we can't read from it
-//
-//		bool read_back = false;
-//		if (read_back) {
-//			(*d_i)->clear();
-//			ifstream ifile(pfile.c_str());
-//			if ( ifile.is_open() ) {
-//				(*d_i)->read(ifile);
-//			} else {
-//				cerr << "Plot: couldn't open file" << endl;
-//			}
-//		}
-//	}
+int Plot::Load() {
+	int i = 0;
+	while (access(StoreName(i).c_str(), R_OK) == 0) {
+		if (!GetData(i).map(StoreName(i))) {
+			cerr << "Plot: couldn't load " << StoreName(i) << endl;
+			break;
+		}
+		++i;
+	}
+	return i;
+}
+
+std::string Plot::StoreName(int index) {
+	return path + svg_file + "." + boost::lexical_cast<std::string>(index) + ".dc";
 }
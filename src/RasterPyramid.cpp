@@ -0,0 +1,249 @@
+/**
+ * @file RasterPyramid.cpp
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+// General files
+#include <RasterPyramid.h>
+#include <PPM.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+/* **************************************************************************************
+ * Implementation of RasterPyramid
+ * **************************************************************************************/
+
+//! log2 of a power of two
+static int shift(int value) {
+	assert (value > 0 && !(value & (value - 1)));
+	int s = 0;
+	while ((1 << s) < value) ++s;
+	return s;
+}
+
+RasterPyramid::RasterPyramid(const std::string & directory): directory(directory),
+		neuron_count(0), level_count(0), tile_ticks(0), tile_neurons(0), ticks_shift(0),
+		neurons_shift(0), last_tick(-1), recording(false) {
+}
+
+RasterPyramid::~RasterPyramid() {
+	flush();
+}
+
+/**
+ * Tiles of an earlier pyramid in the directory are removed, else they would be added to.
+ */
+void RasterPyramid::create(int neurons, int levels, int tile_ticks, int tile_neurons) {
+	assert (neurons > 0 && levels > 0);
+	flush();
+	mkdir(directory.c_str(), 0755);
+	DIR *dir = opendir(directory.c_str());
+	if (dir != NULL) {
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL) {
+			size_t len = strlen(entry->d_name);
+			if (len > 5 && !strcmp(entry->d_name + len - 5, ".tile")) {
+				unlink((directory + "/" + entry->d_name).c_str());
+			}
+		}
+		closedir(dir);
+	}
+	neuron_count = neurons;
+	level_count = levels;
+	this->tile_ticks = tile_ticks;
+	this->tile_neurons = tile_neurons;
+	ticks_shift = shift(tile_ticks);
+	neurons_shift = shift(tile_neurons);
+	last_tick = -1;
+	recording = true;
+	open_column.assign(levels, -1);
+	open.assign(levels, std::vector<uint32_t*>());
+	for (int k = 0; k < levels; ++k) {
+		open[k].assign((((neurons - 1) >> k) >> neurons_shift) + 1, (uint32_t*)NULL);
+	}
+	writeDimensions();
+}
+
+bool RasterPyramid::load() {
+	flush();
+	ifstream in((directory + "/pyramid").c_str());
+	if (!(in >> neuron_count >> level_count >> tile_ticks >> tile_neurons >> last_tick)) {
+		cerr << "No raster pyramid in " << directory << endl;
+		return false;
+	}
+	--last_tick;
+	recording = false;
+	ticks_shift = shift(tile_ticks);
+	neurons_shift = shift(tile_neurons);
+	return true;
+}
+
+void RasterPyramid::writeDimensions() const {
+	ofstream out((directory + "/pyramid").c_str());
+	out << neuron_count << " " << level_count << " " << tile_ticks << " " << tile_neurons << " "
+			<< last_tick + 1 << endl;
+}
+
+std::string RasterPyramid::tileName(int level, long column, long row) const {
+	ostringstream name;
+	name << directory << "/" << level << "_" << column << "_" << row << ".tile";
+	return name.str();
+}
+
+bool RasterPyramid::readTile(int level, long column, long row, std::vector<uint32_t> & tile) const {
+	FILE *stream = fopen(tileName(level, column, row).c_str(), "rb");
+	if (stream == NULL) return false;
+	size_t size = (size_t)tile_ticks * tile_neurons;
+	tile.resize(size);
+	bool complete = fread(&tile[0], sizeof(uint32_t), size, stream) == size;
+	fclose(stream);
+	if (!complete) cerr << "Tile " << tileName(level, column, row) << " is truncated" << endl;
+	return complete;
+}
+
+/**
+ * A column is normally only opened once, but after a flush in the middle of a run the tiles of
+ * the open columns are on disk already and are read back.
+ */
+uint32_t *RasterPyramid::openTile(int level, long column, long row) {
+	size_t size = (size_t)tile_ticks * tile_neurons;
+	uint32_t *tile = new uint32_t[size];
+	std::vector<uint32_t> stored;
+	if (readTile(level, column, row, stored)) {
+		std::copy(stored.begin(), stored.end(), tile);
+	} else {
+		std::fill(tile, tile + size, 0);
+	}
+	return tile;
+}
+
+void RasterPyramid::closeColumn(int level) {
+	size_t size = (size_t)tile_ticks * tile_neurons;
+	std::vector<uint32_t*> & tiles = open[level];
+	for (size_t row = 0; row < tiles.size(); ++row) {
+		if (tiles[row] == NULL) continue;
+		string name = tileName(level, open_column[level], row);
+		FILE *stream = fopen(name.c_str(), "wb");
+		if (stream == NULL || fwrite(tiles[row], sizeof(uint32_t), size, stream) != size) {
+			cerr << "Could not write tile " << name << endl;
+		}
+		if (stream != NULL) fclose(stream);
+		delete [] tiles[row];
+		tiles[row] = NULL;
+	}
+}
+
+void RasterPyramid::flush() {
+	if (!recording) return;
+	for (int k = 0; k < level_count; ++k) {
+		closeColumn(k);
+	}
+	writeDimensions();
+}
+
+/**
+ * Every spike is counted at all levels, which is cheaper than summing tiles into the next
+ * level, as long as the network is not close to firing all the time.
+ */
+void RasterPyramid::operator()(int tick, const std::vector<int> & fired) {
+	assert (recording && tick >= last_tick && tick >= 0);
+	last_tick = tick;
+	for (int k = 0; k < level_count; ++k) {
+		long column = (long)tick >> (k + ticks_shift);
+		if (column != open_column[k]) {
+			closeColumn(k);
+			open_column[k] = column;
+		}
+		int x = (tick >> k) & (tile_ticks - 1);
+		std::vector<uint32_t*> & tiles = open[k];
+		for (size_t i = 0; i < fired.size(); ++i) {
+			assert (fired[i] >= 0 && fired[i] < neuron_count);
+			int y = fired[i] >> k;
+			uint32_t *& tile = tiles[y >> neurons_shift];
+			if (tile == NULL) tile = openTile(k, column, y >> neurons_shift);
+			++tile[(size_t)(y & (tile_neurons - 1)) * tile_ticks + x];
+		}
+	}
+}
+
+/**
+ * Pixels of an image at some level, read from the tiles it covers. Missing tiles have no spikes.
+ */
+struct PyramidRaster {
+	inline DC_TYPE operator()(size_t row, size_t column) const {
+		long x = x0 + column, y = y0 + row;
+		const std::vector<uint32_t> & tile = tiles[((y >> neurons_shift) - ty0) * tile_columns +
+				(x >> ticks_shift) - tx0];
+		if (tile.empty()) return 0;
+		return tile[((y & neurons_mask) << ticks_shift) + (x & ticks_mask)] * scale;
+	}
+
+	long x0, y0, tx0, ty0, tile_columns;
+	int ticks_shift, neurons_shift;
+	long ticks_mask, neurons_mask;
+	DC_TYPE scale;
+	std::vector< std::vector<uint32_t> > tiles;
+};
+
+bool RasterPyramid::render(const std::string & file, int level, long first_tick, long ticks,
+		int first_neuron, int neurons, DC_TYPE gain) {
+	assert (level >= 0 && level < level_count && ticks > 0 && neurons > 0);
+	flush();
+	PyramidRaster raster;
+	raster.x0 = first_tick >> level;
+	raster.y0 = first_neuron >> level;
+	long x1 = ((first_tick + ticks - 1) >> level) + 1;
+	long y1 = ((first_neuron + neurons - 1) >> level) + 1;
+	raster.tx0 = raster.x0 >> ticks_shift;
+	raster.ty0 = raster.y0 >> neurons_shift;
+	raster.tile_columns = ((x1 - 1) >> ticks_shift) - raster.tx0 + 1;
+	long tile_rows = ((y1 - 1) >> neurons_shift) - raster.ty0 + 1;
+	raster.ticks_shift = ticks_shift;
+	raster.neurons_shift = neurons_shift;
+	raster.ticks_mask = tile_ticks - 1;
+	raster.neurons_mask = tile_neurons - 1;
+
+	raster.tiles.resize(raster.tile_columns * tile_rows);
+	uint32_t max_count = 0;
+	for (long r = 0; r < tile_rows; ++r) {
+		for (long c = 0; c < raster.tile_columns; ++c) {
+			std::vector<uint32_t> & tile = raster.tiles[r * raster.tile_columns + c];
+			if (!readTile(level, raster.tx0 + c, raster.ty0 + r, tile)) tile.clear();
+			if (!tile.empty()) max_count = std::max(max_count, *std::max_element(tile.begin(), tile.end()));
+		}
+	}
+	if (gain > 0) {
+		raster.scale = gain / ((DC_TYPE)(1L << level) * (1L << level));
+	} else {
+		raster.scale = max_count ? 1.0 / max_count : 1;
+	}
+	return WritePPM(file, x1 - raster.x0, y1 - raster.y0, raster);
+}
@@ -0,0 +1,232 @@
+/**
+ * @file SpikeArchive.cpp
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+// General files
+#include <SpikeArchive.h>
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+const uint32_t SpikeArchiveVersion = 1;
+
+//! Bit in the bitmap of a neuron
+static inline uint64_t bitOf(int neuron, int neurons, int bitmap_bits) {
+	return (uint64_t)neuron * bitmap_bits / neurons;
+}
+
+/* **************************************************************************************
+ * Implementation of SpikeArchive
+ * **************************************************************************************/
+
+SpikeArchive::SpikeArchive(const std::string & file, int neurons, size_t block_bytes, int bitmap_bits):
+		neurons(neurons), block_bytes(block_bytes), bitmap_bits(bitmap_bits), last_tick(-1), offset(0) {
+	assert (neurons > 0 && bitmap_bits >= 0 && bitmap_bits % 64 == 0);
+	memset(&block, 0, sizeof(block));
+	bitmap.assign(bitmap_bits / 64, 0);
+	stream = fopen(file.c_str(), "wb");
+	if (stream == NULL) {
+		cerr << "Could not open " << file << " for writing" << endl;
+		return;
+	}
+	SpikeTrailer header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "SPKA", 4);
+	header.version = SpikeArchiveVersion;
+	header.neurons = neurons;
+	header.bitmap_bits = bitmap_bits;
+	fwrite(&header, sizeof(header), 1, stream);
+	offset = sizeof(header);
+}
+
+SpikeArchive::~SpikeArchive() {
+	close();
+}
+
+void SpikeArchive::operator()(int tick, const std::vector<int> & fired) {
+	if (stream == NULL || fired.empty()) return;
+	assert (tick > last_tick);
+	const std::vector<int> *spikes = &fired;
+	if (!std::is_sorted(fired.begin(), fired.end())) {
+		sorted = fired;
+		std::sort(sorted.begin(), sorted.end());
+		spikes = &sorted;
+	}
+	if (!block.ticks) block.first_tick = tick;
+	putVarint(payload, tick - (block.ticks ? last_tick : block.first_tick));
+	putVarint(payload, spikes->size());
+	int previous = 0;
+	for (size_t i = 0; i < spikes->size(); ++i) {
+		int neuron = (*spikes)[i];
+		assert (neuron >= 0 && neuron < neurons && neuron >= previous);
+		putVarint(payload, neuron - previous);
+		previous = neuron;
+		if (bitmap_bits) {
+			uint64_t bit = bitOf(neuron, neurons, bitmap_bits);
+			bitmap[bit >> 6] |= (uint64_t)1 << (bit & 63);
+		}
+	}
+	++block.ticks;
+	block.spikes += spikes->size();
+	block.last_tick = last_tick = tick;
+	if (payload.size() >= block_bytes) writeBlock();
+}
+
+/**
+ * Blocks are padded to a multiple of 8 bytes, so the headers and bitmaps are aligned in a mapping.
+ */
+void SpikeArchive::writeBlock() {
+	if (!block.ticks) return;
+	block.payload = payload.size();
+	block.bitmap_words = bitmap.size();
+	SpikeIndex entry;
+	entry.first_tick = block.first_tick;
+	entry.last_tick = block.last_tick;
+	entry.offset = offset;
+	index.push_back(entry);
+
+	payload.resize((payload.size() + 7) & ~(size_t)7, 0);
+	fwrite(&block, sizeof(block), 1, stream);
+	if (!bitmap.empty()) fwrite(&bitmap[0], sizeof(uint64_t), bitmap.size(), stream);
+	fwrite(&payload[0], 1, payload.size(), stream);
+	offset += sizeof(block) + bitmap.size() * sizeof(uint64_t) + payload.size();
+
+	memset(&block, 0, sizeof(block));
+	bitmap.assign(bitmap.size(), 0);
+	payload.clear();
+}
+
+void SpikeArchive::close() {
+	if (stream == NULL) return;
+	writeBlock();
+	SpikeTrailer trailer;
+	memset(&trailer, 0, sizeof(trailer));
+	memcpy(trailer.magic, "SPKA", 4);
+	trailer.version = SpikeArchiveVersion;
+	trailer.neurons = neurons;
+	trailer.bitmap_bits = bitmap_bits;
+	trailer.index_offset = offset;
+	trailer.blocks = index.size();
+	if (!index.empty()) fwrite(&index[0], sizeof(SpikeIndex), index.size(), stream);
+	fwrite(&trailer, sizeof(trailer), 1, stream);
+	if (fclose(stream)) cerr << "Could not write spike archive" << endl;
+	stream = NULL;
+}
+
+/* **************************************************************************************
+ * Implementation of SpikeArchiveReader
+ * **************************************************************************************/
+
+SpikeArchiveReader::SpikeArchiveReader(): data(NULL), size(0), index(NULL), touched(0) {
+	memset(&trailer, 0, sizeof(trailer));
+}
+
+SpikeArchiveReader::~SpikeArchiveReader() {
+	close();
+}
+
+void SpikeArchiveReader::close() {
+	if (data != NULL) munmap((void*)data, size);
+	data = NULL;
+	index = NULL;
+	memset(&trailer, 0, sizeof(trailer));
+}
+
+/**
+ * Every block has to lie before the index, with its bitmap and its payload, so a query never reads
+ * outside of the mapping.
+ */
+bool SpikeArchiveReader::open(const std::string & file) {
+	close();
+	int fd = ::open(file.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) || (size_t)st.st_size < 2 * sizeof(SpikeTrailer)) {
+		::close(fd);
+		cerr << file << " is not a spike archive" << endl;
+		return false;
+	}
+	void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED) return false;
+	data = (const uint8_t*)mapping;
+	size = st.st_size;
+
+	memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+	uint64_t end = size - sizeof(trailer);
+	if (memcmp(trailer.magic, "SPKA", 4) || trailer.version != SpikeArchiveVersion ||
+			trailer.index_offset > end || trailer.blocks > (end - trailer.index_offset) / sizeof(SpikeIndex) ||
+			trailer.index_offset + trailer.blocks * sizeof(SpikeIndex) != end) {
+		cerr << file << " is not a (closed) spike archive" << endl;
+		close();
+		return false;
+	}
+	index = (const SpikeIndex*)(data + trailer.index_offset);
+	for (uint64_t b = 0; b < trailer.blocks; ++b) {
+		bool valid = index[b].offset <= trailer.index_offset &&
+				sizeof(SpikeBlock) <= trailer.index_offset - index[b].offset;
+		if (valid) {
+			const SpikeBlock & block = *(const SpikeBlock*)(data + index[b].offset);
+			uint64_t bytes = sizeof(SpikeBlock) + (uint64_t)block.bitmap_words * sizeof(uint64_t) +
+					block.payload;
+			valid = bytes <= trailer.index_offset - index[b].offset &&
+					(!block.bitmap_words || (uint64_t)block.bitmap_words * 64 >= trailer.bitmap_bits);
+		}
+		if (!valid) {
+			cerr << file << " has a corrupt block " << b << endl;
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+long SpikeArchiveReader::firstBlock(int64_t tick) const {
+	long low = 0, high = trailer.blocks;
+	while (low < high) {
+		long mid = (low + high) / 2;
+		if (index[mid].last_tick < tick) low = mid + 1;
+		else high = mid;
+	}
+	return low;
+}
+
+bool SpikeArchiveReader::overlaps(const uint64_t *bits, uint32_t words, int first_neuron, int last_neuron) const {
+	if (!words) return true;
+	first_neuron = std::max(first_neuron, 0);
+	last_neuron = std::min(last_neuron, (int)trailer.neurons - 1);
+	if (first_neuron > last_neuron) return false;
+	uint64_t first = bitOf(first_neuron, trailer.neurons, trailer.bitmap_bits);
+	uint64_t last = bitOf(last_neuron, trailer.neurons, trailer.bitmap_bits);
+	for (uint64_t bit = first; bit <= last; ++bit) {
+		if ((bits[bit >> 6] >> (bit & 63)) & 1) return true;
+	}
+	return false;
+}
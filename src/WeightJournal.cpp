@@ -0,0 +1,246 @@
+/**
+ * @file WeightJournal.cpp
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+// General files
+#include <WeightJournal.h>
+#include <Varint.h>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <iostream>
+
+using namespace std;
+
+//! Start of a journal file
+struct JournalHeader {
+	char magic[4];					// "WJNL"
+	uint32_t version;
+	double quantum;
+};
+
+const uint32_t JournalVersion = 1;
+
+//! Read a varint from a file
+static bool readVarint(FILE *stream, uint64_t & value) {
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int byte = fgetc(stream);
+		if (byte == EOF) return false;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return true;
+	}
+	return false;
+}
+
+/* **************************************************************************************
+ * Implementation of WeightJournal
+ * **************************************************************************************/
+
+WeightJournal::WeightJournal(const std::string & file, NN_VALUE quantum, int key_interval):
+		quantum(quantum), key_interval(key_interval), generation(-1), frame_count(0), byte_count(0) {
+	assert (quantum > 0 && key_interval > 0);
+	stream = fopen(file.c_str(), "wb");
+	if (stream == NULL) {
+		cerr << "Could not open " << file << " for writing" << endl;
+		return;
+	}
+	JournalHeader header;
+	memcpy(header.magic, "WJNL", 4);
+	header.version = JournalVersion;
+	header.quantum = quantum;
+	fwrite(&header, sizeof(header), 1, stream);
+	byte_count = sizeof(header);
+}
+
+WeightJournal::~WeightJournal() {
+	if (stream != NULL) fclose(stream);
+}
+
+void WeightJournal::flush() {
+	if (stream != NULL) fflush(stream);
+}
+
+/**
+ * Delta frames refer to the weights by their position, so if the network has put its synapses in
+ * another order (see Network::getGeneration) a key frame is recorded.
+ */
+void WeightJournal::record(Network & network) {
+	network.getWeights(weights);
+	bool key = network.getGeneration() != generation;
+	generation = network.getGeneration();
+	record(network.getTick(), weights, key);
+}
+
+/**
+ * In a key frame the weights are stored as differences with the previous weight, which are small
+ * for the many weights that end up at the same bound.
+ */
+void WeightJournal::record(int tick, const std::vector<NN_VALUE> & weights, bool key) {
+	if (stream == NULL) return;
+	payload.clear();
+	key = key || (frame_count % key_interval == 0) || weights.size() != last.size();
+	if (key) {
+		last.resize(weights.size());
+		putVarint(payload, weights.size());
+		int32_t previous = 0;
+		for (size_t i = 0; i < weights.size(); ++i) {
+			int32_t q = lrintf(weights[i] / quantum);
+			putSigned(payload, (int64_t)q - previous);
+			last[i] = previous = q;
+		}
+		write(JF_KEY, tick);
+		return;
+	}
+	size_t previous = 0;
+	for (size_t i = 0; i < weights.size(); ++i) {
+		int32_t q = lrintf(weights[i] / quantum);
+		if (q == last[i]) continue;
+		putVarint(payload, i - previous);
+		putSigned(payload, (int64_t)q - last[i]);
+		last[i] = q;
+		previous = i;
+	}
+	write(JF_DELTA, tick);
+}
+
+void WeightJournal::write(JournalFrame kind, int tick) {
+	assert (tick >= 0);
+	std::vector<uint8_t> header;
+	header.push_back((uint8_t)kind);
+	putVarint(header, tick);
+	putVarint(header, payload.size());
+	fwrite(&header[0], 1, header.size(), stream);
+	if (!payload.empty()) fwrite(&payload[0], 1, payload.size(), stream);
+	byte_count += header.size() + payload.size();
+	++frame_count;
+}
+
+/* **************************************************************************************
+ * Implementation of WeightJournalReader
+ * **************************************************************************************/
+
+WeightJournalReader::WeightJournalReader(): stream(NULL), quantum(0) {
+}
+
+WeightJournalReader::~WeightJournalReader() {
+	if (stream != NULL) fclose(stream);
+}
+
+/**
+ * A journal that has not been closed properly ends with an incomplete frame, which is ignored.
+ */
+bool WeightJournalReader::open(const std::string & file) {
+	if (stream != NULL) fclose(stream);
+	index.clear();
+	stream = fopen(file.c_str(), "rb");
+	if (stream == NULL) return false;
+	JournalHeader header;
+	if (fread(&header, sizeof(header), 1, stream) != 1 || memcmp(header.magic, "WJNL", 4) ||
+			header.version != JournalVersion) {
+		cerr << file << " is not a weight journal" << endl;
+		return false;
+	}
+	quantum = header.quantum;
+	fseek(stream, 0, SEEK_END);
+	long end = ftell(stream);
+	fseek(stream, sizeof(header), SEEK_SET);
+	while (true) {
+		int kind = fgetc(stream);
+		uint64_t tick, size;
+		if (kind == EOF || kind >= JF_COUNT || !readVarint(stream, tick) || !readVarint(stream, size)) break;
+		FrameIndex frame;
+		frame.tick = tick;
+		frame.kind = (JournalFrame)kind;
+		frame.offset = ftell(stream);
+		frame.size = size;
+		if (frame.offset + (long)size > end) break;
+		index.push_back(frame);
+		fseek(stream, size, SEEK_CUR);
+	}
+	return true;
+}
+
+bool WeightJournalReader::apply(const FrameIndex & frame, std::vector<int32_t> & weights) {
+	payload.resize(frame.size);
+	fseek(stream, frame.offset, SEEK_SET);
+	if (frame.size && fread(&payload[0], 1, frame.size, stream) != frame.size) return false;
+	const uint8_t *in = payload.empty() ? NULL : &payload[0];
+	const uint8_t *end = in + payload.size();
+	int64_t value;
+	if (frame.kind == JF_KEY) {
+		uint64_t count;
+		if (!getVarint(in, end, count)) return false;
+		weights.resize(count);
+		int32_t previous = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (!getSigned(in, end, value)) return false;
+			weights[i] = previous += value;
+		}
+		return true;
+	}
+	size_t i = 0;
+	uint64_t distance;
+	while (in < end) {
+		if (!getVarint(in, end, distance) || !getSigned(in, end, value)) return false;
+		i += distance;
+		if (i >= weights.size()) return false;
+		weights[i] += value;
+	}
+	return true;
+}
+
+/**
+ * The frame is looked up with a binary search, after which the last key frame before it is
+ * decoded and the frames in between are applied.
+ */
+int WeightJournalReader::reconstruct(int tick, std::vector<NN_VALUE> & weights) {
+	int frame = -1;
+	int low = 0, high = index.size();
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (index[mid].tick <= tick) {
+			frame = mid;
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (frame < 0) return -1;
+	int key = frame;
+	while (key >= 0 && index[key].kind != JF_KEY) --key;
+	if (key < 0) return -1;
+
+	std::vector<int32_t> quantized;
+	for (int f = key; f <= frame; ++f) {
+		if (!apply(index[f], quantized)) {
+			cerr << "Frame " << f << " of the weight journal is corrupt" << endl;
+			return -1;
+		}
+	}
+	weights.resize(quantized.size());
+	for (size_t i = 0; i < quantized.size(); ++i) {
+		weights[i] = quantized[i] * quantum;
+	}
+	return index[frame].tick;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file WeightSummary.cpp
+ * @brief
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common
+ * Hybrid Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from
+ * thread pools and TCP/IP components to control architectures and learning algorithms.
+ * This software is published under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless,
+ * we personally strongly object against this software used by the military, in the
+ * bio-industry, for animal experimentation, or anything that violates the Universal
+ * Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ *
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ */
+
+
+// General files
+#include <WeightSummary.h>
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+/* **************************************************************************************
+ * Implementation of WeightSummary
+ * **************************************************************************************/
+
+WeightSummary::WeightSummary(int bins, NN_VALUE min, NN_VALUE max, int block):
+		bins(bins), min(min), max(max), block(block), populations(0) {
+	assert (bins > 0 && max > min && block >= 0);
+}
+
+//! Make a list of count empty histograms, in the memory of the list if it has that size already
+static void reset(std::vector<Histogram> & histograms, size_t count, const Histogram & empty) {
+	if (histograms.size() != count) histograms.assign(count, empty);
+	for (size_t i = 0; i < count; ++i) histograms[i].clear();
+}
+
+/**
+ * Every thread fills its own histograms over a part of the synapses, and afterwards every thread
+ * adds up those of all threads for a part of the histograms. So the synapses are visited once, and
+ * there is no contention between the threads. The histograms of the threads are kept for the next
+ * call, so nothing is allocated as long as the network and the number of threads stay the same.
+ */
+void WeightSummary::summarize(Network & network) {
+	populations = block ? (network.getNeuronCount() + block - 1) / block : NS_COUNT;
+	size_t pair_count = (size_t)populations * populations;
+	size_t delay_count = network.getMaxDelay();
+	Histogram empty(HS_LINEAR, min, max, bins);
+	int threads = 1;
+#ifdef _OPENMP
+	threads = omp_get_max_threads();
+#endif
+	delays.resize(delay_count, empty);
+	pairs.resize(pair_count, empty);
+	sums.resize(pair_count);
+	thread_delays.resize(threads);
+	thread_pairs.resize(threads);
+	thread_sums.resize(threads);
+
+	// weights are clamped, the ones at the maximum go into the last bin
+	NN_VALUE top = nextafterf(max, min);
+	long count = network.getSynapseCount();
+	#pragma omp parallel num_threads(threads)
+	{
+		int thread = 0, team = 1;
+#ifdef _OPENMP
+		thread = omp_get_thread_num();
+		team = omp_get_num_threads();
+#endif
+		reset(thread_delays[thread], delay_count, empty);
+		reset(thread_pairs[thread], pair_count, empty);
+		thread_sums[thread].assign(pair_count, 0);
+		std::vector<Histogram> & local_delays = thread_delays[thread];
+		std::vector<Histogram> & local_pairs = thread_pairs[thread];
+		std::vector<double> & local_sums = thread_sums[thread];
+
+		#pragma omp for schedule(static)
+		for (long i = 0; i < count; ++i) {
+			const Synapse *synapse = network.getSynapse(i);
+			if (synapse->pruned) continue;
+			assert (synapse->delay >= 0 && synapse->delay < (int)delay_count);
+			int p = population(synapse->pre) * populations + population(synapse->post);
+			NN_VALUE weight = std::min(synapse->weight, top);
+			local_delays[synapse->delay].add(weight);
+			local_pairs[p].add(weight);
+			local_sums[p] += synapse->weight;
+		}
+
+		// the implicit barrier above ends the filling, every histogram is added up by one thread
+		#pragma omp for schedule(static)
+		for (long h = 0; h < (long)(delay_count + pair_count); ++h) {
+			if (h < (long)delay_count) {
+				delays[h].clear();
+				for (int t = 0; t < team; ++t) delays[h].merge(thread_delays[t][h]);
+			} else {
+				size_t p = h - delay_count;
+				pairs[p].clear();
+				sums[p] = 0;
+				for (int t = 0; t < team; ++t) {
+					pairs[p].merge(thread_pairs[t][p]);
+					sums[p] += thread_sums[t][p];
+				}
+			}
+		}
+	}
+}
+
+NN_VALUE WeightSummary::mean(int pre, int post) const {
+	int p = pre * populations + post;
+	return pairs[p].count() ? sums[p] / pairs[p].count() : 0;
+}
+
+void WeightSummary::getDelayGrid(DataContainer & grid) const {
+	grid.clear();
+	std::vector<DC_TYPE> column(bins);
+	for (size_t d = 0; d < delays.size(); ++d) {
+		const Histogram & histogram = delays[d];
+		long highest = 0;
+		for (int b = 0; b < bins; ++b) {
+			highest = std::max(highest, histogram.at(b));
+		}
+		for (int b = 0; b < bins; ++b) {
+			column[bins - 1 - b] = highest ? histogram.at(b) / (DC_TYPE)highest : 0;
+		}
+		grid.addItems(column, d);
+	}
+}
+
+/**
+ * Pairs without synapses are black (a negative value).
+ */
+void WeightSummary::getPairGrid(DataContainer & grid) const {
+	grid.clear();
+	std::vector<DC_TYPE> column(populations);
+	for (int pre = 0; pre < populations; ++pre) {
+		for (int post = 0; post < populations; ++post) {
+			column[post] = pair(pre, post).count() ? (mean(pre, post) - min) / (max - min) : -1;
+		}
+		grid.addItems(column, pre);
+	}
+}
+
+void WeightSummary::print(std::ostream & out) const {
+	for (int pre = 0; pre < populations; ++pre) {
+		for (int post = 0; post < populations; ++post) {
+			if (!pair(pre, post).count()) continue;
+			out << "Weights " << pre << " -> " << post << ": mean " << mean(pre, post)
+					<< ", median " << pair(pre, post).quantile(0.5)
+					<< " (n=" << pair(pre, post).count() << ")" << endl;
+		}
+	}
+}
@@ -0,0 +1,218 @@
+/***************************************************************************************************
+ * @brief
+ * @file BenchNetwork.cpp
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <Network.h>
+
+using namespace std;
+
+/**
+ * Sizes and connection fractions that are benchmarked by default. Configurations with more
+ * synapses than the maximum (see --max-synapses) are reported as skipped, so the 1M neuron
+ * case only runs on machines where it is set high enough.
+ */
+const int Sizes[] = { 1000, 10000, 100000, 1000000 };
+const float Fractions[] = { 0.01, 0.02, 0.05, 0.1 };
+
+/**
+ * Monotonic time in nanoseconds.
+ */
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * The time spent in each phase of a tick, summed over all measured ticks, and the number of
+ * spikes and synapse events as counted by the network.
+ */
+struct PhaseTimes {
+	double construct;
+	double spikes;
+	double synapses;
+	double neurons;
+	double upkeep;
+	double tick;
+	double get_spikes;
+	long spike_count;
+	long event_count;
+	//! 99th percentile of the duration of a tick, bursts show up here rather than in the mean
+	double tick_p99;
+};
+
+/**
+ * Build a network of the given size in the same way as TestNetwork does: 80% excitatory and
+ * 20% inhibitory neurons, randomly connected with the given fraction.
+ */
+static Network *construct(int size, float fraction) {
+	Network *network = new Network();
+	for (int i = 0; i < (float)size * 0.8; ++i) {
+		network->addNeuron(NT_POLYCHRONOUS_EXCITATORY, NS_EXCITATORY, NL_HIDDEN);
+	}
+	for (int i = 0; i < (float)size * 0.2; ++i) {
+		network->addNeuron(NT_POLYCHRONOUS_INHIBITORY, NS_INHIBITORY, NL_HIDDEN);
+	}
+	network->addSynapses(fraction);
+	return network;
+}
+
+/**
+ * Run the network for a number of ticks with tick(), so the phases are timed by the counters of
+ * the network itself (this target is compiled with NETWORK_STATS), including merging and
+ * compaction. Their cycles are converted to ns with the clock over the whole measurement. The
+ * warm-up ticks are not measured, so the network has left its initial transient.
+ */
+static void measure(Network &network, int warmup, int ticks, PhaseTimes &pt) {
+	std::vector<bool> activity;
+	std::vector<double> durations(ticks);
+	network.run(warmup);
+	network.resetStats();
+	double start = now();
+	uint64_t start_cycles = cycles();
+	for (int t = 0; t < ticks; ++t) {
+		double t0 = now();
+		network.tick();
+		double t1 = now();
+		network.getSpikes(activity);
+		double t2 = now();
+		pt.tick += t1 - t0;
+		pt.get_spikes += t2 - t1;
+		durations[t] = t1 - t0;
+	}
+	uint64_t elapsed_cycles = cycles() - start_cycles;
+	double ns_per_cycle = elapsed_cycles ? (now() - start) / elapsed_cycles : 0.0;
+
+	const NetworkStats & stats = network.getStats();
+	pt.spikes = stats.cycles[NP_SPIKES] * ns_per_cycle;
+	pt.synapses = stats.cycles[NP_SYNAPSES] * ns_per_cycle;
+	pt.neurons = stats.cycles[NP_NEURONS] * ns_per_cycle;
+	pt.upkeep = stats.cycles[NP_UPKEEP] * ns_per_cycle;
+	pt.spike_count = stats.spikes;
+	pt.event_count = stats.events;
+	if (ticks <= 0) return;
+	std::vector<double>::iterator p99 = durations.begin() + (size_t)(ticks * 0.99);
+	std::nth_element(durations.begin(), p99, durations.end());
+	pt.tick_p99 = *p99;
+}
+
+static void usage(const char *name) {
+	cerr << "Usage: " << name << " [--ticks N] [--warmup N] [--max-synapses N] [--size N]... "
+			"[--fraction F]..." << endl;
+	cerr << "Results are written as JSON to stdout." << endl;
+}
+
+/**
+ * Benchmark the separate phases of Network::tick() over a range of network sizes and
+ * connection fractions. The output is a JSON array with one object per configuration.
+ * A synapse event is the delivery of one spike over one synapse, as counted by the network.
+ */
+int main(int argc, char *argv[]) {
+	int ticks = 1000;
+	int warmup = 100;
+	double max_synapses = 5e7;
+	std::vector<int> sizes;
+	std::vector<float> fractions;
+
+	for (int i = 1; i < argc; ++i) {
+		if (i + 1 < argc && !strcmp(argv[i], "--ticks")) {
+			ticks = atoi(argv[++i]);
+		} else if (i + 1 < argc && !strcmp(argv[i], "--warmup")) {
+			warmup = atoi(argv[++i]);
+		} else if (i + 1 < argc && !strcmp(argv[i], "--max-synapses")) {
+			max_synapses = atof(argv[++i]);
+		} else if (i + 1 < argc && !strcmp(argv[i], "--size")) {
+			sizes.push_back(atoi(argv[++i]));
+		} else if (i + 1 < argc && !strcmp(argv[i], "--fraction")) {
+			fractions.push_back(atof(argv[++i]));
+		} else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (sizes.empty())
+		sizes.assign(Sizes, Sizes + sizeof(Sizes) / sizeof(Sizes[0]));
+	if (fractions.empty())
+		fractions.assign(Fractions, Fractions + sizeof(Fractions) / sizeof(Fractions[0]));
+
+	bool first = true;
+	printf("[\n");
+	for (size_t s = 0; s < sizes.size(); ++s) {
+		for (size_t f = 0; f < fractions.size(); ++f) {
+			int size = sizes[s];
+			float fraction = fractions[f];
+			if (!first) printf(",\n");
+			first = false;
+
+			double expected = (double)size * size * fraction;
+			if (expected > max_synapses) {
+				printf("  { \"neurons\": %d, \"fraction\": %g, \"skipped\": true, "
+						"\"expected_synapses\": %.0f }", size, fraction, expected);
+				fflush(stdout);
+				continue;
+			}
+			cerr << "Benchmark " << size << " neurons with fraction " << fraction << endl;
+
+			PhaseTimes pt;
+			memset(&pt, 0, sizeof(pt));
+			double t0 = now();
+			Network *network = construct(size, fraction);
+			pt.construct = now() - t0;
+
+			measure(*network, warmup, ticks, pt);
+
+			double neuron_ticks = (double)size * ticks;
+			long synapses = network->getSynapseCount();
+			double events = pt.event_count;
+			printf("  { \"neurons\": %d, \"fraction\": %g, \"synapses\": %ld, \"ticks\": %d,\n",
+					size, fraction, synapses, ticks);
+			printf("    \"construct_ms\": %.3f,\n", pt.construct / 1e6);
+			printf("    \"spikes_per_tick\": %.3f,\n", (double)pt.spike_count / ticks);
+			printf("    \"events_per_tick\": %.3f,\n", events / ticks);
+			printf("    \"update_spikes_ns_per_neuron\": %.3f,\n", pt.spikes / neuron_ticks);
+			printf("    \"update_neurons_ns_per_neuron\": %.3f,\n", pt.neurons / neuron_ticks);
+			printf("    \"get_spikes_ns_per_neuron\": %.3f,\n", pt.get_spikes / neuron_ticks);
+			printf("    \"upkeep_ns_per_tick\": %.3f,\n", pt.upkeep / ticks);
+			printf("    \"update_synapses_ns_per_synapse\": %.3f,\n",
+					pt.synapses / ((double)synapses * ticks));
+			printf("    \"update_synapses_ns_per_event\": %.3f,\n",
+					events > 0 ? pt.synapses / events : 0.0);
+			printf("    \"tick_ns_per_neuron\": %.3f,\n",
+					pt.tick / neuron_ticks);
+			printf("    \"tick_p99_us\": %.3f,\n", pt.tick_p99 / 1e3);
+			printf("    \"bytes_per_synapse\": %.3f }",
+					synapses > 0 ? (double)network->getSynapseMemory() / synapses : 0.0);
+			fflush(stdout);
+
+			delete network;
+		}
+	}
+	printf("\n]\n");
+	return EXIT_SUCCESS;
+}
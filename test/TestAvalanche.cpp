@@ -0,0 +1,135 @@
+/***************************************************************************************************
+ * @brief
+ * @file TestAvalanche.cpp
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+
+#include <Avalanche.h>
+
+#define SAMPLES				100000
+#define ALPHA				2.5
+
+using namespace std;
+
+static int failures = 0;
+
+//! Count in the bin of a histogram that contains the value
+static long countAt(const Histogram & histogram, double value) {
+	for (int i = 0; i < histogram.bins(); ++i) {
+		if (histogram.lower(i) <= value && value < histogram.upper(i)) return histogram.at(i);
+	}
+	return 0;
+}
+
+static void check(bool condition, const char *what, double value) {
+	if (condition) return;
+	cout << what << " (" << value << ")" << endl;
+	++failures;
+}
+
+/**
+ * Spikes per tick 0 3 2 0 0 5 0 1: two avalanches of size 5, of 2 and 1 ticks, and a third one
+ * that only ends with flush().
+ */
+static void testTicks() {
+	Avalanche avalanche;
+	int spikes[] = { 0, 3, 2, 0, 0, 5, 0, 1 };
+	for (int i = 0; i < 8; ++i) avalanche.add(spikes[i]);
+	check(avalanche.count() == 2, "avalanches before the flush", avalanche.count());
+	avalanche.flush();
+	check(avalanche.count() == 3, "avalanches after the flush", avalanche.count());
+	check(countAt(avalanche.getSizes(), 5) == 2, "avalanches of size 5", countAt(avalanche.getSizes(), 5));
+	check(countAt(avalanche.getDurations(), 1) == 2, "avalanches of 1 tick",
+			countAt(avalanche.getDurations(), 1));
+	check(countAt(avalanche.getDurations(), 2) == 1, "avalanches of 2 ticks",
+			countAt(avalanche.getDurations(), 2));
+}
+
+/**
+ * With a threshold of 1 per tick and bins of 2 ticks, a bin is active with more than 2 spikes.
+ * Spikes per tick 2 0 | 1 2 | 3 0 | 0 0 | 9 9 give one avalanche of size 6 over 2 bins, and one
+ * that is ongoing.
+ */
+static void testBins() {
+	Avalanche avalanche(1, 2);
+	int spikes[] = { 2, 0, 1, 2, 3, 0, 0, 0, 9, 9 };
+	for (int i = 0; i < 10; ++i) avalanche.add(spikes[i]);
+	check(avalanche.count() == 1, "avalanches in bins", avalanche.count());
+	check(countAt(avalanche.getSizes(), 6) == 1, "avalanches of size 6", countAt(avalanche.getSizes(), 6));
+	check(countAt(avalanche.getDurations(), 2) == 1, "avalanches of 2 bins",
+			countAt(avalanche.getDurations(), 2));
+	avalanche.flush();
+	check(avalanche.count() == 2, "avalanches in bins after the flush", avalanche.count());
+}
+
+/**
+ * As observer only the ticks with spikes are seen. A gap of one tick ends an avalanche, within a
+ * bin of 3 ticks it does not. The silence in between has to keep the bins aligned.
+ */
+static void testObserver() {
+	std::vector<int> fired(4, 0);
+	Avalanche ticks, bins(0, 3);
+	int t[] = { 1, 2, 4, 5, 6, 100, 101, 102 };
+	for (int i = 0; i < 8; ++i) {
+		ticks(t[i], fired);
+		bins(t[i], fired);
+	}
+	ticks.flush();
+	bins.flush();
+	check(ticks.count() == 3, "avalanches of the observer", ticks.count());
+	check(bins.count() == 2, "avalanches of the observer in bins", bins.count());
+	check(countAt(bins.getDurations(), 1) == 1, "avalanches of the observer of 1 bin",
+			countAt(bins.getDurations(), 1));
+}
+
+/**
+ * Samples of a discrete power law, drawn by rounding a continuous one, have to give back the
+ * exponent within a few standard errors.
+ */
+static void testFit() {
+	PowerLawFit fit(5);
+	check(fit.exponent() == 0 && fit.error() == 0, "fit without samples", fit.exponent());
+	srand(SAMPLES);
+	for (int s = 0; s < SAMPLES; ++s) {
+		double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+		fit.add((long)floor((fit.x_min - 0.5) * pow(u, -1 / (ALPHA - 1)) + 0.5));
+	}
+	check(fit.n == SAMPLES, "samples in the fit", fit.n);
+	check(fit.error() > 0 && fit.error() < 0.01, "standard error", fit.error());
+	check(fabs(fit.exponent() - ALPHA) < 5 * fit.error() + 0.02, "exponent", fit.exponent());
+
+	PowerLawFit minimum(5);
+	minimum.add(5);
+	minimum.add(4);
+	check(minimum.n == 1, "samples below the minimum", minimum.n);
+}
+
+int main() {
+	testTicks();
+	testBins();
+	testObserver();
+	testFit();
+	cout << failures << " failures" << endl;
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+/***************************************************************************************************
+ * @brief
+ * @file TestDataContainer.cpp
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include <DataDecorator.h>
+
+#define HEIGHT				5
+#define WINDOW				4
+#define DECIMATION			2
+#define HISTORY				3
+#define COLUMNS				16
+#define FILE_NAME			"TestDataContainer.dc"
+
+using namespace std;
+
+static int failures = 0;
+
+//! The value of item i of column c, for a bit raster only some of them are set
+static DC_TYPE item(int c, int i, DataLayout layout) {
+	if (layout == DL_BITS) return (c + i) % 3 == 0;
+	return c * 10 + i;
+}
+
+//! Fill a container with COLUMNS columns at x-coordinates 0, 1, ...
+static void fill(DataContainer & container, DataLayout layout) {
+	for (int c = 0; c < COLUMNS; ++c) {
+		if (layout == DL_BITS) {
+			std::vector<bool> column(HEIGHT);
+			for (int i = 0; i < HEIGHT; ++i) column[i] = item(c, i, layout);
+			container.addItems(column, c);
+		} else {
+			std::vector<DC_TYPE> column(HEIGHT);
+			for (int i = 0; i < HEIGHT; ++i) column[i] = item(c, i, layout);
+			container.addItems(column, c);
+		}
+	}
+}
+
+/**
+ * The container has to hold the columns from "first" on, the i-th item of column c at x c and
+ * y i, in logical order. With decimation the history holds averages of that many columns, at the
+ * x-coordinate of the first of them.
+ */
+static void compare(const DataContainer & container, DataLayout layout, int first, int decimation,
+		const char *what) {
+	for (size_t k = 0; k < container.size(); ++k) {
+		int c = first + decimation * (k / HEIGHT), i = k % HEIGHT;
+		DC_TYPE expected = 0;
+		for (int d = 0; d < decimation; ++d) expected += item(c + d, i, layout);
+		expected /= decimation;
+		DataItem found = container.getItem(k);
+		if (found.coord_x != c || found.coord_y != i || found.value != expected
+				|| container.value(k) != expected) {
+			cout << what << ": item " << k << " is (" << found.coord_x << "," << found.coord_y
+					<< ") " << found.value << " instead of (" << c << "," << i << ") " << expected << endl;
+			++failures;
+			return;
+		}
+	}
+}
+
+/**
+ * A window of 4 columns keeps columns 12..15 and has wrapped around several times. The 12
+ * columns that dropped out are averaged per 2 into the history, which keeps the last 3 of them,
+ * so it has wrapped around as well and holds columns 6..11.
+ */
+static void testWindow(DataLayout layout) {
+	const char *name = (layout == DL_BITS) ? "bits window" : "columns window";
+	DataContainer container;
+	container.setLayout(layout);
+	container.setWindow(WINDOW, DECIMATION, HISTORY);
+	fill(container, layout);
+	if (container.size() != WINDOW * HEIGHT || container.getFirstColumn() != COLUMNS % WINDOW) {
+		cout << name << ": " << container.size() << " items from column " << container.getFirstColumn()
+				<< endl;
+		++failures;
+	}
+	compare(container, layout, COLUMNS - WINDOW, 1, name);
+
+	DataContainer *history = container.getHistory();
+	if (history == NULL || history->size() != HISTORY * HEIGHT) {
+		cout << name << ": no history of " << HISTORY << " columns" << endl;
+		++failures;
+		return;
+	}
+	compare(*history, layout, COLUMNS - WINDOW - HISTORY * DECIMATION, DECIMATION, name);
+
+	// after clearing, the window starts again from the first column
+	container.clear();
+	fill(container, layout);
+	compare(container, layout, COLUMNS - WINDOW, 1, name);
+}
+
+/**
+ * A container that is written, read back and mapped has to have the same items. A window that
+ * wrapped around is stored in logical order, so it comes back as a plain container.
+ */
+static void testFile(DataLayout layout, bool window) {
+	const char *name = (layout == DL_BITS) ? (window ? "bits window file" : "bits file") :
+			(window ? "columns window file" : "columns file");
+	DataContainer container;
+	container.setLayout(layout);
+	if (window) container.setWindow(WINDOW);
+	container.SetID(7);
+	fill(container, layout);
+	int first = window ? COLUMNS - WINDOW : 0;
+	if (!container.write(std::string(FILE_NAME))) {
+		cout << name << ": could not write " << FILE_NAME << endl;
+		++failures;
+		return;
+	}
+
+	DataContainer read, mapped;
+	std::ifstream in(FILE_NAME, std::ios::binary);
+	if (!read.read(in) || !mapped.map(FILE_NAME) || !mapped.mapped()) {
+		cout << name << ": could not read or map " << FILE_NAME << endl;
+		++failures;
+		return;
+	}
+	DataContainer *back[2] = { &read, &mapped };
+	for (int b = 0; b < 2; ++b) {
+		if (back[b]->size() != container.size() || back[b]->getLayout() != layout
+				|| back[b]->height() != HEIGHT || back[b]->GetID() != 7) {
+			cout << name << ": " << back[b]->size() << " items of height " << back[b]->height()
+					<< " instead of " << container.size() << " of height " << HEIGHT << endl;
+			++failures;
+		}
+		compare(*back[b], layout, first, 1, name);
+	}
+
+	// the same through a stream
+	std::stringstream stream;
+	container.write(stream);
+	DataContainer streamed;
+	if (!streamed.read(stream)) {
+		cout << name << ": could not read the stream" << endl;
+		++failures;
+	}
+	compare(streamed, layout, first, 1, name);
+	remove(FILE_NAME);
+}
+
+//! Write a raster with a changed header, read() and map() have to reject it
+static bool rejected(int32_t height, uint64_t columns, size_t truncate = 0) {
+	DataContainer container;
+	container.setLayout(DL_BITS);
+	fill(container, DL_BITS);
+	std::stringstream stream;
+	container.write(stream);
+	std::string data = stream.str();
+	DataFileHeader header;
+	memcpy(&header, data.data(), sizeof(header));
+	header.height = height;
+	header.columns = columns;
+	memcpy(&data[0], &header, sizeof(header));
+	data.resize(data.size() - truncate);
+	std::ofstream out(FILE_NAME, std::ios::binary);
+	out.write(data.data(), data.size());
+	out.close();
+
+	DataContainer read, mapped;
+	std::stringstream in(data);
+	bool result = !read.read(in) && !mapped.map(FILE_NAME) && !read.size() && !mapped.size();
+	remove(FILE_NAME);
+	return result;
+}
+
+//! Headers of which the raster does not consist of whole columns, and a truncated file
+static void testCorrupt() {
+	const char *what[] = { "height 0", "negative height", "more columns", "fewer columns",
+			"partial column", "truncated file" };
+	bool results[] = {
+			rejected(0, COLUMNS),
+			rejected(-HEIGHT, COLUMNS),
+			rejected(HEIGHT, COLUMNS + 1),
+			rejected(HEIGHT * 2, COLUMNS),
+			rejected(HEIGHT + 1, COLUMNS),
+			rejected(HEIGHT, COLUMNS, 1) };
+	for (int i = 0; i < 6; ++i) {
+		if (results[i]) continue;
+		cout << "corrupt file: " << what[i] << " is accepted" << endl;
+		++failures;
+	}
+	if (!rejected(HEIGHT, COLUMNS)) return;
+	cout << "corrupt file: a valid header is rejected" << endl;
+	++failures;
+}
+
+int main() {
+	testWindow(DL_COLUMNS);
+	testWindow(DL_BITS);
+	testFile(DL_COLUMNS, false);
+	testFile(DL_COLUMNS, true);
+	testFile(DL_BITS, false);
+	testFile(DL_BITS, true);
+	testCorrupt();
+	cout << failures << " failures" << endl;
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+/***************************************************************************************************
+ * @brief
+ * @file TestDynamics.cpp
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+
+#include <Network.h>
+#include <Equivalence.hpp>
+
+#define SEED				11
+#define TRIALS				10
+#define SPIKE_TICK			10
+#define TIME_SPAN			5
+#define GABA_REVERSAL		-70
+#define NETWORK_SIZE		200
+#define MODE_SPAN			500
+#define CHARGE_TICK			2
+#define CHARGE_SPAN			4
+#define CHARGE_DELAY		2
+#define CHARGE_ERROR		1e-3
+
+using namespace std;
+
+const char *DynamicsNames[] = { "instant", "current", "conductance" };
+
+const char *ModeNames[DM_COUNT] = { "scan", "push", "pull", "auto" };
+
+/**
+ * An inhibitory neuron with one synapse to an excitatory neuron. Both get random thalamic input,
+ * which is the same for networks from the same seed.
+ */
+static Network *construct(SynapticDynamics dynamics, ConnNeuron *& pre, ConnNeuron *& post,
+		InputBuffer *input, bool inhibition = true) {
+	Network *network = new Network(SEED);
+	pre = network->addNeuron(NT_POLYCHRONOUS_INHIBITORY, NS_INHIBITORY, NL_HIDDEN);
+	post = network->addNeuron(NT_POLYCHRONOUS_EXCITATORY, NS_EXCITATORY, NL_HIDDEN);
+	network->addSynapse(pre, post);
+	network->setSynapticDynamics(dynamics);
+	network->setInhibition(inhibition);
+	network->setInput(input);
+	return network;
+}
+
+/**
+ * A spike of the inhibitory neuron is scheduled in one network and not in the other. In the
+ * first tick in which the potentials of the post-synaptic neurons differ, the one that got the
+ * spike has to have the lower potential. Trials in which the inhibitory neuron fired by itself
+ * in the tick of the scheduled spike, or in which a post-synaptic neuron fires in that tick, say
+ * nothing and are skipped. So are the trials in which the potential was below the reversal
+ * potential of GABA, where a conductance rightly raises it.
+ */
+static int testInhibition(SynapticDynamics dynamics) {
+	int failures = 0, tested = 0;
+	for (int trial = 0; trial < TRIALS; ++trial) {
+		int spike_tick = SPIKE_TICK * (trial + 1);
+		InputBuffer input;
+		input.addSpike(spike_tick, 0);
+		ConnNeuron *scheduled, *inhibited, *spontaneous, *other;
+		Network *with = construct(dynamics, scheduled, inhibited, &input);
+		Network *without = construct(dynamics, spontaneous, other, NULL);
+		NN_VALUE before = other->neuron->getPotential();
+		for (int t = 1; t <= spike_tick + TIME_SPAN; ++t) {
+			with->tick();
+			without->tick();
+			if (t == spike_tick && spontaneous->raised()) break;
+			NN_VALUE v = inhibited->neuron->getPotential(), reference = other->neuron->getPotential();
+			if (v == reference) {
+				before = v;
+				continue;
+			}
+			if (inhibited->neuron->fired() || other->neuron->fired()) break;
+			if (dynamics == SD_CONDUCTANCE && before <= GABA_REVERSAL) break;
+			++tested;
+			if (v > reference) {
+				cout << DynamicsNames[dynamics] << ": potential " << v << " instead of below "
+						<< reference << " at tick " << t << " after an inhibitory spike at tick "
+						<< spike_tick << endl;
+				++failures;
+			}
+			break;
+		}
+		delete without;
+		delete with;
+	}
+	cout << DynamicsNames[dynamics] << ": " << tested << " of " << TRIALS << " trials tested, "
+			<< failures << " failed" << endl;
+	return tested ? failures : 1;
+}
+
+//! Without inhibition an inhibitory spike has no effect at all, whatever the dynamics
+static int testSwitch(SynapticDynamics dynamics) {
+	InputBuffer input;
+	input.addSpike(SPIKE_TICK, 0);
+	ConnNeuron *scheduled, *inhibited, *spontaneous, *other;
+	Network *with = construct(dynamics, scheduled, inhibited, &input, false);
+	Network *without = construct(dynamics, spontaneous, other, NULL, false);
+	int failures = 0;
+	for (int t = 1; t <= SPIKE_TICK + TIME_SPAN && !failures; ++t) {
+		with->tick();
+		without->tick();
+		if (inhibited->neuron->getPotential() == other->neuron->getPotential()) continue;
+		cout << DynamicsNames[dynamics] << ": an inhibitory spike has an effect without inhibition"
+				<< endl;
+		++failures;
+	}
+	delete without;
+	delete with;
+	return failures;
+}
+
+/**
+ * The current with which Neuron::update has changed the potential from v to next, with the
+ * parameters of NT_POLYCHRONOUS_EXCITATORY. The recovery u is updated as well.
+ */
+static double current(NN_VALUE v, NN_VALUE next, NN_VALUE & u) {
+	double input = (next - v) / 0.5 - ((0.04 * v + 5.0) * v + 140.0 - u);
+	u += NN_VALUE(0.02) * (NN_VALUE(0.2) * next - u);
+	return input;
+}
+
+/**
+ * An input neuron, which only fires when it is told to, with one synapse to an excitatory neuron.
+ * The spike arrives in tick "arrival", early, before the thalamic input makes the post-synaptic
+ * neuron fire by itself. A synapse only delivers if its post-synaptic neuron fired
+ * recently, so that neuron is told to fire a tick before, which does not change its potential.
+ * The synaptic current in every tick is what is left of the change of the potential after the
+ * thalamic input (0 or 20) is taken off. From the arrival on, the sum of that current, plus what
+ * is still in the AMPA state, has to be the weight / 3, as SD_INSTANT delivers at once. Trials
+ * in which the post-synaptic neuron fires by itself say nothing, its recovery is not known then.
+ */
+static int testCharge(SynapticDynamics dynamics) {
+	int failures = 0, tested = 0;
+	for (int trial = 0; trial < TRIALS; ++trial) {
+		Network network(SEED + trial);
+		network.setMaxDelay(CHARGE_DELAY);
+		ConnNeuron *pre = network.addNeuron(NT_POLYCHRONOUS_EXCITATORY, NS_EXCITATORY, NL_INPUT);
+		ConnNeuron *post = network.addNeuron(NT_POLYCHRONOUS_EXCITATORY, NS_EXCITATORY, NL_HIDDEN);
+		network.addSynapse(pre, post);
+		network.setSynapticDynamics(dynamics);
+		Synapse *synapse = network.getSynapse(0);
+		int arrival = CHARGE_TICK + synapse->delay;
+		InputBuffer input;
+		input.addSpike(CHARGE_TICK, pre->id);
+		input.addSpike(arrival - 1, post->id);
+		network.setInput(&input);
+
+		NN_VALUE v = post->neuron->getPotential(), u = NN_VALUE(0.2) * v;
+		double charge = 0, delivered = 0;
+		bool valid = true;
+		for (int t = 1; t <= arrival + CHARGE_SPAN && valid; ++t) {
+			network.tick();
+			if (post->neuron->fired() || (t == arrival && post->raised())) {
+				valid = false;
+				break;
+			}
+			double synaptic = current(v, post->neuron->getPotential(), u);
+			synaptic -= (synaptic > 10) ? 20 : 0;
+			v = post->neuron->getPotential();
+			if (t < arrival) valid = fabs(synaptic) < CHARGE_ERROR;
+			else charge += synaptic;
+			if (t == arrival) delivered = synapse->weight / NN_VALUE(3);
+		}
+		if (!valid) continue;
+		++tested;
+		charge += post->receptor[SR_AMPA];
+		if (fabs(charge - delivered) > CHARGE_ERROR) {
+			cout << DynamicsNames[dynamics] << ": charge " << charge << " instead of " << delivered
+					<< " after a spike at tick " << arrival << endl;
+			++failures;
+		}
+	}
+	cout << DynamicsNames[dynamics] << ": " << tested << " of " << TRIALS
+			<< " trials of the charge tested, " << failures << " failed" << endl;
+	return tested ? failures : 1;
+}
+
+static Network *construct(SynapticDynamics dynamics, DeliveryMode mode) {
+	Network *network = new Network(SEED);
+	for (int i = 0; i < (float)NETWORK_SIZE * 0.8; ++i) {
+		network->addNeuron(NT_POLYCHRONOUS_EXCITATORY, NS_EXCITATORY, NL_HIDDEN);
+	}
+	for (int i = 0; i < (float)NETWORK_SIZE * 0.2; ++i) {
+		network->addNeuron(NT_POLYCHRONOUS_INHIBITORY, NS_INHIBITORY, NL_HIDDEN);
+	}
+	network->addSynapses(0.1);
+	network->setSynapticDynamics(dynamics);
+	network->setInhibition(true);
+	network->setDelivery(mode);
+	return network;
+}
+
+/**
+ * The inhibitory input is added after the excitatory input in every delivery mode, so these have
+ * to give exactly the same spikes and weights as a scan with inhibition as well.
+ */
+static int testModes(SynapticDynamics dynamics) {
+	int failures = 0;
+	for (int mode = DM_PUSH; mode < DM_COUNT; ++mode) {
+		Network *reference = construct(dynamics, DM_SCAN);
+		Network *candidate = construct(dynamics, (DeliveryMode)mode);
+		Equivalence<Network> harness(*reference, *candidate);
+		EquivalenceReport report = harness.run(MODE_SPAN);
+		cout << DynamicsNames[dynamics] << " " << ModeNames[mode] << " with inhibition: ";
+		report.print(cout);
+		if (!report.exact) ++failures;
+		delete candidate;
+		delete reference;
+	}
+	return failures;
+}
+
+int main() {
+	int failures = 0;
+	for (int dynamics = SD_INSTANT; dynamics <= SD_CONDUCTANCE; ++dynamics) {
+		failures += testInhibition((SynapticDynamics)dynamics);
+		failures += testSwitch((SynapticDynamics)dynamics);
+		failures += testModes((SynapticDynamics)dynamics);
+	}
+	failures += testCharge(SD_INSTANT);
+	failures += testCharge(SD_CURRENT);
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/***************************************************************************************************
+ * @brief
+ * @file TestEquivalence.cpp
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+#include <stdlib.h>
+#include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <Network.h>
+#include <Equivalence.hpp>
+
+#define NETWORK_SIZE		1000
+#define TIME_SPAN			1000
+#define SEED				11
+
+using namespace std;
+
+const char *ModeNames[DM_COUNT] = { "scan", "push", "pull", "auto" };
+
+/**
+ * The same network as in TestNetwork, from a fixed seed.
+ */
+static Network *construct(DeliveryMode mode, long grain) {
+	Network *network = new Network(SEED);
+	for (int i = 0; i < (float)NETWORK_SIZE * 0.8; ++i) {
+		network->addNeuron(NT_POLYCHRONOUS_EXCITATORY, NS_EXCITATORY, NL_HIDDEN);
+	}
+	for (int i = 0; i < (float)NETWORK_SIZE * 0.2; ++i) {
+		network->addNeuron(NT_POLYCHRONOUS_INHIBITORY, NS_INHIBITORY, NL_HIDDEN);
+	}
+	network->addSynapses(0.1);
+	network->setDelivery(mode);
+	network->setParallelGrain(grain);
+	return network;
+}
+
+/**
+ * Every delivery mode has to give exactly the same spikes and weights as a sequential scan over
+ * all synapses, also when the synapses are divided over several threads. A small grain makes the
+ * parallel runs split almost every tick.
+ */
+int main() {
+#ifdef _OPENMP
+	if (omp_get_max_threads() < 4) omp_set_num_threads(4);
+#endif
+	long grains[] = { 0, 256 };
+	int failures = 0;
+	for (int g = 0; g < 2; ++g) {
+		for (int mode = DM_SCAN; mode < DM_COUNT; ++mode) {
+			Network *reference = construct(DM_SCAN, 0);
+			Network *candidate = construct((DeliveryMode)mode, grains[g]);
+			Equivalence<Network> harness(*reference, *candidate);
+			EquivalenceReport report = harness.run(TIME_SPAN);
+			cout << ModeNames[mode] << (grains[g] ? " parallel: " : " serial: ");
+			report.print(cout);
+			if (!report.exact) ++failures;
+			delete candidate;
+			delete reference;
+		}
+	}
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/***************************************************************************************************
+ * @brief
+ * @file TestEventCounter.cpp
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+
+#include <stdlib.h>
+#include <iostream>
+#include <map>
+
+#include <EventCounter.hpp>
+
+#define EVENTS				100000
+
+using namespace std;
+
+static int failures = 0;
+
+//! The counter has to agree with a map on every count and on the number of non-zero types
+template <typename T>
+static void compare(EventCounter<T> & counter, const std::map<T,int> & reference, const char *what) {
+	size_t distinct = 0;
+	typename std::map<T,int>::const_iterator it;
+	for (it = reference.begin(); it != reference.end(); ++it) {
+		if (it->second) ++distinct;
+		if (counter.count(it->first) != it->second) {
+			cout << what << ": count " << counter.count(it->first) << " of " << it->first
+					<< " instead of " << it->second << endl;
+			++failures;
+			return;
+		}
+	}
+	if (counter.size() != distinct) {
+		cout << what << ": " << counter.size() << " types instead of " << distinct << endl;
+		++failures;
+	}
+	if (counter.getEvents().size() != distinct) {
+		cout << what << ": " << counter.getEvents().size() << " sorted types instead of "
+				<< distinct << endl;
+		++failures;
+	}
+}
+
+/**
+ * Random events and removals (negative frequencies) within the given range. A range above
+ * MaxDenseRange moves the counts from the dense array to the hash table halfway.
+ */
+static void testRandom(long range, const char *what) {
+	EventCounter<long> counter;
+	std::map<long,int> reference;
+	srand(range);
+	for (int e = 0; e < EVENTS; ++e) {
+		long type = (e < EVENTS / 2 ? (long)(rand() % 1000) : (long)rand() % range) - range / 2;
+		int freq = (rand() % 4 == 0) ? -reference[type] : 1 + rand() % 3;
+		counter.AddEvent(type, freq);
+		reference[type] += freq;
+	}
+	compare(counter, reference, what);
+
+	// the counts of another counter are added, whatever its backend
+	EventCounter<long> other;
+	for (int e = 0; e < 1000; ++e) {
+		other.AddEvent(e * 7, 2);
+		reference[e * 7] += 2;
+	}
+	counter.merge(other);
+	compare(counter, reference, what);
+	EventCounter<long> copy;
+	copy.merge(counter);
+	counter.clear();
+	counter.merge(copy);
+	compare(counter, reference, what);
+}
+
+//! Floating point types are hashed, with -0.0 and 0.0 being the same type
+static void testFloating() {
+	EventCounter<double> counter;
+	std::map<double,int> reference;
+	counter.AddEvent(0.0);
+	counter.AddEvent(-0.0);
+	reference[0.0] = 2;
+	for (int e = 0; e < EVENTS / 10; ++e) {
+		double type = (rand() % 5000) * 0.25;
+		counter.AddEvent(type);
+		reference[type] += 1;
+	}
+	compare(counter, reference, "floating");
+
+	// counts back to zero are not types anymore, but keep their slot
+	for (std::map<double,int>::iterator it = reference.begin(); it != reference.end(); ++it) {
+		if (it->first < 500) {
+			counter.AddEvent(it->first, -it->second);
+			it->second = 0;
+		}
+	}
+	compare(counter, reference, "floating");
+
+	Histogram histogram(HS_LINEAR, 0, 1250, 10);
+	counter.Fill(histogram);
+	long total = 0;
+	for (std::map<double,int>::iterator it = reference.begin(); it != reference.end(); ++it) {
+		total += it->second;
+	}
+	if (histogram.count() != total) {
+		cout << "floating: " << histogram.count() << " events in the histogram instead of "
+				<< total << endl;
+		++failures;
+	}
+}
+
+int main() {
+	testRandom(1000, "dense");
+	testRandom(EventCounter<long>::MaxDenseRange * 4L, "dense to hash");
+	testFloating();
+	cout << failures << " failures" << endl;
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
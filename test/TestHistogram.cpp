@@ -0,0 +1,123 @@
+/***************************************************************************************************
+ * @brief
+ * @file TestHistogram.cpp
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+
+#include <Histogram.h>
+
+#define SAMPLES				100000
+
+using namespace std;
+
+const char *ScaleNames[HS_COUNT] = { "linear", "log", "hdr" };
+
+static int failures = 0;
+
+static void check(bool condition, const char *scale, const char *what, double value) {
+	if (condition) return;
+	cout << scale << ": " << what << " (" << value << ")" << endl;
+	++failures;
+}
+
+/**
+ * Every value has to end up in a bin of which the bounds contain it, and the bounds have to
+ * increase from the minimum to the maximum.
+ */
+static void testBins(HistogramScale scale, double min, double max, int bins) {
+	Histogram histogram(scale, min, max, bins);
+	const char *name = ScaleNames[scale];
+	check(histogram.lower(0) == min, name, "first bin does not start at the minimum", histogram.lower(0));
+	check(histogram.upper(histogram.bins() - 1) == max, name, "last bin does not end at the maximum",
+			histogram.upper(histogram.bins() - 1));
+	for (int i = 0; i < histogram.bins(); ++i) {
+		check(histogram.lower(i) <= histogram.upper(i), name, "bounds decrease in bin", i);
+	}
+	srand(SAMPLES);
+	for (int s = 0; s < SAMPLES / 100; ++s) {
+		double r = rand() / (RAND_MAX + 1.0);
+		double value = (scale == HS_LINEAR) ? min + (max - min) * r : min * pow(max / min, r);
+		histogram.clear();
+		histogram.add(value);
+		int i = 0;
+		while (i < histogram.bins() && !histogram.at(i)) ++i;
+		check(i < histogram.bins(), name, "value not counted in any bin", value);
+		if (i == histogram.bins()) continue;
+		check(histogram.lower(i) <= value && value < histogram.upper(i), name,
+				"value outside the bounds of its bin", value);
+	}
+}
+
+//! Values outside the range are counted separately, and merging adds all counts
+static void testRange(HistogramScale scale) {
+	const char *name = ScaleNames[scale];
+	Histogram a(scale, 3, 1000, 16), b(scale, 3, 1000, 16);
+	a.add(1);
+	a.add(2.99, 2);
+	a.add(3);
+	b.add(1000);
+	b.add(500, 4);
+	a.merge(b);
+	check(a.count() == 9, name, "wrong count", a.count());
+	check(a.below() == 3, name, "wrong count below the minimum", a.below());
+	check(a.above() == 1, name, "wrong count above the maximum", a.above());
+	std::map<double,long> bins;
+	a.getBins(bins);
+	long sum = 0;
+	for (std::map<double,long>::iterator it = bins.begin(); it != bins.end(); ++it) sum += it->second;
+	check(sum == 5, name, "wrong count in the bins", sum);
+	check(bins.begin()->first == 3, name, "lowest non-empty bin not at the minimum", bins.begin()->first);
+}
+
+/**
+ * With 2^k bins per power of two, a quantile of an HS_HDR histogram is within a relative error of
+ * 2^-k of the exact one, here of uniformly distributed values.
+ */
+static void testQuantiles() {
+	Histogram histogram(HS_HDR, 1, 1 << 20, 32);
+	srand(SAMPLES);
+	for (int s = 0; s < SAMPLES; ++s) {
+		histogram.add(1 + rand() % 100000);
+	}
+	double qs[] = { 0.01, 0.5, 0.9, 0.99 };
+	for (int i = 0; i < 4; ++i) {
+		double exact = qs[i] * 100000;
+		double error = fabs(histogram.quantile(qs[i]) - exact) / exact;
+		check(error < 1.0 / 32 + 0.01, "hdr", "relative error of a quantile too large", error);
+	}
+	check(histogram.quantile(0) == 1, "hdr", "quantile 0 is not the minimum", histogram.quantile(0));
+}
+
+int main() {
+	testBins(HS_LINEAR, -10, 10, 20);
+	testBins(HS_LOG, 3, 1e6, 50);
+	testBins(HS_HDR, 3, 1e6, 8);
+	testBins(HS_HDR, 0.1, 0.9, 16);
+	for (int scale = 0; scale < HS_COUNT; ++scale) {
+		testRange((HistogramScale)scale);
+	}
+	testQuantiles();
+	cout << failures << " failures" << endl;
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -54,23 +54,17 @@ int main() {
 	plot.Init(PL_GRID);
 	plot.SetFileName("test", PL_GRID);
 	DataContainer &data = plot.GetData();
+	data.setLayout(DL_BITS);
+	data.reserve((size_t)NETWORK_SIZE * TIME_SPAN);
 
 	std::vector<bool> spikes;
-	std::vector<DC_TYPE> activity;
 	for (int t = 0; t < TIME_SPAN; ++t) {
 		network->tick();
 		int r = network->getSpikes(spikes);
 		if (!(t % 100)) {
 			cout << "[t=" << t << "] spike count: " << r << endl;
 		}
-		activity.clear();
-//		cout << "t=" << t << ": ";
-		for (int i = 0; i < spikes.size(); ++i) {
-			activity.push_back(spikes[i]);
-//			cout << (spikes[i] ? "! " : "X ");
-		}
-//		cout << endl;
-		data.addItems(activity, t);
+		data.addItems(spikes, t);
 	}
 	plot.Draw(PL_GRID);
 
@@ -0,0 +1,114 @@
+/***************************************************************************************************
+ * @brief
+ * @file TestPruning.cpp
+ *
+ * This file is created at Almende B.V. It is open-source software and part of the Common Hybrid
+ * Agent Platform (CHAP). A toolbox with a lot of open-source tools, ranging from thread pools and
+ * TCP/IP components to control architectures and learning algorithms. This software is published
+ * under the GNU Lesser General Public license (LGPL).
+ *
+ * It is not possible to add usage restrictions to an open-source license. Nevertheless, we
+ * personally strongly object against this software used by the military, in the bio-industry, for
+ * animal experimentation, or anything that violates the Universal Declaration of Human Rights.
+ *
+ * Copyright © 2012 Anne van Rossum <anne@almende.com>
+ ***************************************************************************************************
+ * @author 	Anne C. van Rossum
+ * @date	May 14, 2012
+ * @project	Replicator FP7
+ * @company	Almende B.V. & Distributed Organisms B.V.
+ * @case	Self-organised criticality
+ **************************************************************************************************/
+
+#include <stdlib.h>
+#include <iostream>
+
+#include <Network.h>
+#include <Equivalence.hpp>
+
+#define NETWORK_SIZE		200
+#define SEED				11
+#define PRUNE_TICKS			30
+#define ADD_TICK			7
+
+using namespace std;
+
+const char *ModeNames[DM_COUNT] = { "scan", "push", "pull", "auto" };
+
+static Network *construct(DeliveryMode mode, std::vector<ConnNeuron*> & excitatory) {
+	Network *network = new Network(SEED);
+	excitatory.clear();
+	for (int i = 0; i < (float)NETWORK_SIZE * 0.8; ++i) {
+		excitatory.push_back(network->addNeuron(NT_POLYCHRONOUS_EXCITATORY, NS_EXCITATORY, NL_HIDDEN));
+	}
+	for (int i = 0; i < (float)NETWORK_SIZE * 0.2; ++i) {
+		network->addNeuron(NT_POLYCHRONOUS_INHIBITORY, NS_INHIBITORY, NL_HIDDEN);
+	}
+	network->addSynapses(0.1);
+	network->setDelivery(mode);
+	return network;
+}
+
+/**
+ * No weight can be above a floor of 10, so every excitatory synapse is held at the floor from the
+ * moment pruning is enabled, or from the moment it is added. It has to be pruned exactly
+ * PRUNE_TICKS ticks later, whether it is visited in those ticks or not. Compaction in every tick
+ * makes the count of pruned synapses exact for a push or pull as well.
+ */
+static int testExpiry(DeliveryMode mode) {
+	std::vector<ConnNeuron*> excitatory;
+	Network *network = construct(mode, excitatory);
+	long count = 0;
+	for (long i = 0; i < network->getSynapseCount(); ++i) {
+		if (network->getSynapse(i)->pre->neuron->getSign() == NS_EXCITATORY) ++count;
+	}
+	network->setPruning(PRUNE_TICKS, 10, 1);
+
+	int failures = 0;
+	for (int t = 1; t <= ADD_TICK + PRUNE_TICKS + 1; ++t) {
+		network->tick();
+		if (t == ADD_TICK) network->addSynapse(excitatory[0], excitatory[1]);
+		long expected = (t >= PRUNE_TICKS ? count : 0) + (t >= ADD_TICK + PRUNE_TICKS ? 1 : 0);
+		if (network->getPrunedCount() != expected) {
+			cout << ModeNames[mode] << ": " << network->getPrunedCount() << " synapses pruned at tick "
+					<< t << " instead of " << expected << endl;
+			++failures;
+		}
+	}
+	delete network;
+	return failures;
+}
+
+/**
+ * With a floor at the initial weight, synapses of which the weight does not rise are pruned at
+ * different ticks, many of them without being visited by a push or a pull. The dynamics have to be the same as with a scan.
+ */
+static int testEquivalence(DeliveryMode mode) {
+	std::vector<ConnNeuron*> excitatory;
+	Network *reference = construct(DM_SCAN, excitatory);
+	Network *candidate = construct(mode, excitatory);
+	reference->setPruning(PRUNE_TICKS, 6.0, 100);
+	candidate->setPruning(PRUNE_TICKS, 6.0, 100);
+	Equivalence<Network> harness(*reference, *candidate);
+	EquivalenceReport report = harness.run(1000);
+	cout << ModeNames[mode] << " with " << candidate->getPrunedCount() << " synapses pruned: ";
+	report.print(cout);
+	int failures = report.exact ? 0 : 1;
+	if (reference->getSynapseCount() != candidate->getSynapseCount()) {
+		cout << ModeNames[mode] << ": " << candidate->getSynapseCount() << " synapses left instead of "
+				<< reference->getSynapseCount() << endl;
+		++failures;
+	}
+	delete candidate;
+	delete reference;
+	return failures;
+}
+
+int main() {
+	int failures = 0;
+	for (int mode = DM_SCAN; mode < DM_COUNT; ++mode) {
+		failures += testExpiry((DeliveryMode)mode);
+		failures += testEquivalence((DeliveryMode)mode);
+	}
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}